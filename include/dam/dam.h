@@ -14,14 +14,102 @@ extern "C" {
  * ================================ */
 void* dam_malloc(size_t size);
 void  dam_free(void* ptr);
+void  dam_free_sized(void* ptr, size_t size);
 void* dam_realloc(void* ptr, size_t size);
 void* dam_calloc(size_t nmemb, size_t size);
 
+size_t dam_malloc_batch(size_t size, size_t count, void** out);
+void   dam_free_batch(void** ptrs, size_t count);
+
+/* ================================
+ * Extended allocation API
+ * ================================ */
+void* dam_mallocx(size_t size, int flags);
+void* dam_reallocx(void* ptr, size_t size, int flags);
+
+size_t dam_usable_size(void* ptr);
+void*  dam_malloc_at_least(size_t size, size_t* actual);
+void*  dam_clone(void* ptr);
+
+/* ================================
+ * Size class API
+ * ================================ */
+void* dam_class_malloc(unsigned class_index);
+void  dam_class_free(void* ptr, unsigned class_index);
+
+/* ================================
+ * Aligned allocation API
+ * ================================ */
+void* dam_aligned_alloc(size_t alignment, size_t size);
+int   dam_posix_memalign(void** memptr, size_t alignment, size_t size);
+void* dam_memalign(size_t alignment, size_t size);
+
 /* ================================
  * Lifecycle
  * ================================ */
 int  dam_init(void);
 void dam_shutdown(void);
+int  dam_reserve(int target, size_t bytes, unsigned flags);
+
+/* ================================
+ * Shared memory API
+ * ================================ */
+dam_shared_heap_t* dam_shared_create(const char* name, size_t size);
+dam_shared_heap_t* dam_shared_open(const char* name);
+dam_shared_heap_t* dam_shared_open_fd(int fd);
+void  dam_shared_close(dam_shared_heap_t* heap);
+int   dam_shared_unlink(const char* name);
+int   dam_shared_fd(const dam_shared_heap_t* heap);
+void* dam_shared_malloc(dam_shared_heap_t* heap, size_t size);
+void  dam_shared_free(dam_shared_heap_t* heap, void* ptr);
+uint64_t dam_shared_offset(const dam_shared_heap_t* heap, const void* ptr);
+void* dam_shared_ptr(const dam_shared_heap_t* heap, uint64_t offset);
+
+/* ================================
+ * Persistent heap API
+ * ================================ */
+dam_persistent_heap_t* dam_persistent_open(const char* path, size_t size);
+int   dam_persistent_sync(dam_persistent_heap_t* heap);
+void  dam_persistent_close(dam_persistent_heap_t* heap);
+void* dam_persistent_malloc(dam_persistent_heap_t* heap, size_t size);
+void  dam_persistent_free(dam_persistent_heap_t* heap, void* ptr);
+void* dam_persistent_root(const dam_persistent_heap_t* heap);
+void  dam_persistent_set_root(dam_persistent_heap_t* heap, void* ptr);
+uint64_t dam_persistent_offset(const dam_persistent_heap_t* heap, const void* ptr);
+void* dam_persistent_ptr(const dam_persistent_heap_t* heap, uint64_t offset);
+
+/* ================================
+ * Arena API
+ * ================================ */
+dam_arena_t* dam_arena_create(size_t chunk_size);
+void* dam_arena_alloc(dam_arena_t* arena, size_t size);
+void* dam_arena_alloc_aligned(dam_arena_t* arena, size_t size, size_t alignment);
+void  dam_arena_reset(dam_arena_t* arena);
+void  dam_arena_destroy(dam_arena_t* arena);
+
+/* ================================
+ * Heap API
+ * ================================ */
+dam_heap_t* dam_heap_create(void);
+void* dam_heap_malloc(dam_heap_t* heap, size_t size);
+void  dam_heap_free(dam_heap_t* heap, void* ptr);
+void* dam_heap_realloc(dam_heap_t* heap, void* ptr, size_t size);
+void  dam_heap_destroy(dam_heap_t* heap);
+
+/* ================================
+ * Deferred free API
+ * ================================ */
+int  dam_deferred_free_enable(void);
+void dam_deferred_free_disable(void);
+void dam_deferred_free_flush(void);
+
+/* ================================
+ * Tuning API
+ * ================================ */
+void dam_direct_cache_configure(size_t max_bytes, size_t max_entry_size, uint64_t max_age_ms);
+void dam_direct_cache_flush(void);
+void dam_set_huge_page_policy(unsigned policy);
+unsigned dam_get_huge_page_policy(void);
 
 /* ================================
  * Validation API
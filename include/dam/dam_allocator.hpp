@@ -0,0 +1,45 @@
+#pragma once
+#include "dam.h"
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <type_traits>
+
+namespace dam {
+    // Stateless allocator for standard containers, e.g. std::vector<int, dam::allocator<int>>.
+    template <typename T>
+    class allocator {
+        // dam_free_sized() only routes allocations that sit in the layer of their size, over-aligned ones may not.
+        static constexpr bool over_aligned = alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+    public:
+        using value_type = T;
+        using size_type = size_t;
+        using difference_type = std::ptrdiff_t;
+        using propagate_on_container_move_assignment = std::true_type;
+        using is_always_equal = std::true_type;
+
+        allocator() noexcept = default;
+        template <typename U>
+        allocator(const allocator<U>&) noexcept {}
+
+        T* allocate(size_t n) {
+            if (n > std::numeric_limits<size_t>::max() / sizeof(T)) throw std::bad_array_new_length();
+
+            size_t size = n ? n * sizeof(T) : 1;
+            void* ptr = over_aligned ? dam_aligned_alloc(alignof(T), size) : dam_malloc(size);
+            if (!ptr) throw std::bad_alloc();
+            return static_cast<T*>(ptr);
+        }
+
+        void deallocate(T* ptr, size_t n) noexcept {
+            if (over_aligned) dam_free(ptr);
+            else dam_free_sized(ptr, n ? n * sizeof(T) : 1);
+        }
+
+        template <typename U>
+        bool operator==(const allocator<U>&) const noexcept { return true; }
+        template <typename U>
+        bool operator!=(const allocator<U>&) const noexcept { return false; }
+    };
+}
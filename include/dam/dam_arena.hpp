@@ -0,0 +1,71 @@
+#pragma once
+#include "dam.h"
+#include <cstddef>
+#include <utility>
+#include <new>
+
+namespace dam {
+    // Owns a dam_arena_t, objects made in it are never destroyed one by one.
+    class arena {
+        dam_arena_t* handle;
+
+    public:
+        explicit arena(size_t chunk_size = 0) noexcept : handle(dam_arena_create(chunk_size)) {}
+
+        // destroy
+        ~arena() noexcept {
+            if (handle) dam_arena_destroy(handle);
+        }
+
+        // no copy
+        arena(const arena&) = delete;
+        arena& operator=(const arena&) = delete;
+
+        // move
+        arena(arena&& other) noexcept : handle(other.handle) {
+            other.handle = nullptr;
+        }
+        arena& operator=(arena&& other) noexcept {
+            if (this != &other) {
+                if (handle) dam_arena_destroy(handle);
+                handle = other.handle;
+                other.handle = nullptr;
+            }
+            return *this;
+        }
+
+        void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) noexcept {
+            return dam_arena_alloc_aligned(handle, size, alignment);
+        }
+
+        template<typename T, typename... Args>
+        T* make(Args&&... args) {
+            void* ptr = allocate(sizeof(T), alignof(T));
+            if (!ptr) return nullptr;
+            return new (ptr) T(std::forward<Args>(args)...);
+        }
+
+        void reset() noexcept { dam_arena_reset(handle); }
+
+        dam_arena_t* get() const noexcept { return handle; }
+
+        explicit operator bool() const noexcept { return handle != nullptr; }
+    };
+
+    // Resets the arena when the scope ends, e.g. once per request.
+    class arena_scope {
+        dam_arena_t* handle;
+
+    public:
+        explicit arena_scope(dam_arena_t* a) noexcept : handle(a) {}
+        explicit arena_scope(arena& a) noexcept : handle(a.get()) {}
+
+        ~arena_scope() noexcept {
+            if (handle) dam_arena_reset(handle);
+        }
+
+        // no copy, no move
+        arena_scope(const arena_scope&) = delete;
+        arena_scope& operator=(const arena_scope&) = delete;
+    };
+}
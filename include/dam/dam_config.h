@@ -20,23 +20,57 @@
 #define DAM_ENABLE_VALIDATION 1
 #endif
 
+// dam_free_sized() checks the size against the allocation before trusting it
+#ifndef DAM_SIZED_FREE_CHECK
+#define DAM_SIZED_FREE_CHECK DAM_DEBUG
+#endif
+
+// Initial dam_huge_page_policy_t flags, can be changed with dam_set_huge_page_policy()
+#ifndef DAM_HUGE_PAGE_POLICY
+#define DAM_HUGE_PAGE_POLICY 0
+#endif
+
+// Back every direct allocation with a memfd, as if DAM_MALLOCX_CLONEABLE was passed
+#ifndef DAM_DIRECT_MEMFD
+#define DAM_DIRECT_MEMFD 0
+#endif
+
 /*****************
  * Configuration *
  *****************/
 #define DAM_SMALL_MIN 16
 #define DAM_SMALL_MAX 256
 #define DAM_GENERAL_MAX KiB(64)
+#define DAM_SPAN_MAX MiB(32)
 #define MAX_POOLS 20
 #define MAX_POOL_OVERFLOW_TO_DIRECT_ALLOWED 0
 #define INITIAL_POOL_SIZE MiB(1)
 #define DAM_DIRECT_SHRINK_PERCENTAGE 80
 
+// Direct mapping cache, freed mappings are kept around for reuse instead of munmap()
+#define DAM_DIRECT_CACHE_MAX_BYTES MiB(256)
+#define DAM_DIRECT_CACHE_MAX_ENTRY_SIZE MiB(128)
+#define DAM_DIRECT_CACHE_MAX_AGE_MS 2000
+#define DAM_DIRECT_CACHE_SLACK_PERCENTAGE 25
+#define DAM_DIRECT_CACHE_BUCKETS 16
+#define DAM_DIRECT_HEADER_SLAB_SIZE KiB(16)
+
+// Realloc copies and zeroing of at least this many bytes use non-temporal stores, 0 = size of the last level cache
+#ifndef DAM_STREAMING_THRESHOLD
+#define DAM_STREAMING_THRESHOLD 0
+#endif
+#define DAM_STREAMING_FALLBACK MiB(8) // Used when the cache size is unknown
+
+// libdam_preload.so serves allocations made while DAM itself initializes from a static buffer of this size
+#define DAM_PRELOAD_BOOTSTRAP_SIZE KiB(256)
+
 /********************
  * Size & alignment *
  ********************/
 #define ALIGN_UP_CONST(x, a) (((x) + ((a) - 1)) & ~((a) - 1))
 #define ALIGNMENT (_Alignof(max_align_t))
 #define PAGE_SIZE KiB(4) // Assumed number
+#define HUGE_PAGE_SIZE MiB(2) // Assumed number
 #define TRACE_SIZE 16 // Can be dangerous to change
 
 // Headers
@@ -53,10 +87,32 @@
 #define MIN_BLOCK_SIZE ALIGN_UP_CONST(BLOCK_HEADER_SIZE + DAM_SMALL_MAX + 1 + sizeof(CANARY_VALUE), ALIGNMENT)
 #define POOL_GENERAL_SIZE ALIGN_UP_CONST(sizeof(pool_header_t), PAGE_SIZE)
 
+// Spans, page granular runs carved from big chunks
+#define DAM_SPAN_CHUNK_SIZE MiB(64)
+#define DAM_SPAN_CHUNK_PAGES (DAM_SPAN_CHUNK_SIZE / PAGE_SIZE)
+
 // Multi threading & thread local caches
 #define THREAD_CACHE_MAX_BLOCKS_PER_CLASS 64
 #define THREAD_CACHE_REFILL_BATCH_SIZE 8
 
+// dam_free_batch() sorts pointers per layer in groups of this many, each layer lock is taken once per group
+#define DAM_FREE_BATCH_GROUP 64
+
+// Shared and persistent regions
+#define DAM_REGION_VERSION 2 // Bumped whenever the region layout changes
+#define DAM_REGION_MIN_SPLIT 64 // Smallest free remainder worth its own block
+
+// Arenas, default chunk size fits the general layer
+#define DAM_ARENA_CHUNK_SIZE DAM_GENERAL_MAX
+
+// dam::object_pool, slabs fit the general layer, magazines move half their capacity per pool lock
+#define DAM_OBJECT_POOL_SLAB_SIZE DAM_GENERAL_MAX
+#define DAM_OBJECT_POOL_MAGAZINE_SIZE 64
+
+// Deferred free, per thread ring of pending frees drained by a background reclaimer
+#define DAM_DEFERRED_FREE_RING_SIZE 1024 // Power of two, a full ring falls back to a synchronous free
+#define DAM_DEFERRED_FREE_INTERVAL_MS 1 // Reclaimer sleep between passes, half full rings wake it earlier
+
 /******************
  * resources      *
  ******************/
@@ -67,6 +123,12 @@
 #define FREED_MAGIC 0xFEEDFACE
 #define SMALL_MAGIC 0xD34D
 #define SMALL_FREED_MAGIC 0xF33D
+#define SMALL_SHADOW_MAGIC 0x5AD0
+#define HEAP_MAGIC 0x4EA90000
+#define REGION_MAGIC 0xDA3E6100
+#define REGION_BLOCK_MAGIC 0xDA3EB10C
+#define REGION_FREED_MAGIC 0xDA3EF4EE
+#define HEAP_DESTROYED_MAGIC 0x4EA9DEAD
 #define CANARY_VALUE 0xDEADC0DE
 
 #endif
@@ -0,0 +1,9 @@
+#pragma once
+
+namespace dam {
+    // Mutex argument for single threaded variants of the synchronized templates.
+    struct null_mutex {
+        void lock() noexcept {}
+        void unlock() noexcept {}
+    };
+}
@@ -0,0 +1,190 @@
+#pragma once
+#include "dam.h"
+#include "dam_mutex.hpp"
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <utility>
+
+namespace dam {
+    /*
+     * Pool of slots for one type, carved from slabs of DAM_OBJECT_POOL_SLAB_SIZE bytes. Slot size and alignment
+     * are fixed at compile time, construct() and destroy() are an intrusive free list pop and push.
+     * Destroying the pool frees every slab at once, objects still alive are not destroyed.
+     * Mutex guards the pool for magazines on other threads, the default null_mutex keeps it single threaded.
+     */
+    template <typename T, typename Mutex = null_mutex>
+    class object_pool {
+        union slot {
+            slot* next;
+            alignas(T) unsigned char storage[sizeof(T)];
+        };
+
+        struct slab {
+            slab* next;
+        };
+
+        static constexpr size_t slot_alignment = alignof(slot);
+        static constexpr size_t header_size = (sizeof(slab) + slot_alignment - 1) / slot_alignment * slot_alignment;
+        static constexpr size_t min_slots = 8;
+        static constexpr size_t slots_per_slab = DAM_OBJECT_POOL_SLAB_SIZE >= header_size + min_slots * sizeof(slot)
+            ? (DAM_OBJECT_POOL_SLAB_SIZE - header_size) / sizeof(slot) : min_slots;
+        static constexpr size_t slab_size = header_size + slots_per_slab * sizeof(slot);
+        static constexpr bool over_aligned = slot_alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+        slab* slabs = nullptr;
+        slot* free_list = nullptr;
+        slot* bump = nullptr; // Untouched tail of the newest slab
+        slot* bump_end = nullptr;
+        Mutex mutex;
+
+        void add_slab() {
+            void* memory = over_aligned ? dam_aligned_alloc(slot_alignment, slab_size) : dam_malloc(slab_size);
+            if (!memory) throw std::bad_alloc();
+
+            slab* new_slab = static_cast<slab*>(memory);
+            new_slab->next = slabs;
+            slabs = new_slab;
+
+            bump = reinterpret_cast<slot*>(static_cast<char*>(memory) + header_size);
+            bump_end = bump + slots_per_slab;
+        }
+
+        // Caller holds the mutex.
+        slot* take_slot() {
+            if (free_list) {
+                slot* taken = free_list;
+                free_list = taken->next;
+                return taken;
+            }
+
+            if (bump == bump_end) add_slab();
+            return bump++;
+        }
+
+        // Caller holds the mutex.
+        void give_slot(slot* given) noexcept {
+            given->next = free_list;
+            free_list = given;
+        }
+
+        size_t take_slots(slot** out, size_t count) {
+            std::lock_guard<Mutex> guard(mutex);
+
+            size_t taken = 0;
+            try {
+                while (taken < count) out[taken++] = take_slot();
+            } catch (const std::bad_alloc&) {
+                if (taken == 0) throw;
+            }
+            return taken;
+        }
+
+        void give_slots(slot* const* slots, size_t count) noexcept {
+            std::lock_guard<Mutex> guard(mutex);
+            for (size_t i = 0; i < count; i++) give_slot(slots[i]);
+        }
+
+    public:
+        class magazine;
+
+        object_pool() noexcept = default;
+
+        // release
+        ~object_pool() noexcept { release(); }
+
+        // no copy
+        object_pool(const object_pool&) = delete;
+        object_pool& operator=(const object_pool&) = delete;
+
+        template <typename... Args>
+        T* construct(Args&&... args) {
+            slot* taken;
+            {
+                std::lock_guard<Mutex> guard(mutex);
+                taken = take_slot();
+            }
+
+            try {
+                return new (taken->storage) T(std::forward<Args>(args)...);
+            } catch (...) {
+                std::lock_guard<Mutex> guard(mutex);
+                give_slot(taken);
+                throw;
+            }
+        }
+
+        void destroy(T* ptr) noexcept {
+            if (!ptr) return;
+            ptr->~T();
+
+            std::lock_guard<Mutex> guard(mutex);
+            give_slot(reinterpret_cast<slot*>(ptr));
+        }
+
+        // Frees every slab, objects still alive are not destroyed. Magazines must be gone by now.
+        void release() noexcept {
+            std::lock_guard<Mutex> guard(mutex);
+
+            while (slabs) {
+                slab* next = slabs->next;
+                if (over_aligned) dam_free(slabs);
+                else dam_free_sized(slabs, slab_size);
+                slabs = next;
+            }
+
+            free_list = nullptr;
+            bump = nullptr;
+            bump_end = nullptr;
+        }
+
+        static constexpr size_t objects_per_slab() noexcept { return slots_per_slab; }
+    };
+
+    /*
+     * Per thread stack of slots in front of a shared pool, refilled and drained half a magazine at a time
+     * under one pool lock. Use one per thread, e.g. thread_local, and destroy it before the pool.
+     */
+    template <typename T, typename Mutex>
+    class object_pool<T, Mutex>::magazine {
+        static constexpr size_t capacity = DAM_OBJECT_POOL_MAGAZINE_SIZE;
+
+        object_pool& pool;
+        slot* slots[capacity];
+        size_t count = 0;
+
+    public:
+        explicit magazine(object_pool& owner) noexcept : pool(owner) {}
+
+        // hand back
+        ~magazine() noexcept { pool.give_slots(slots, count); }
+
+        // no copy
+        magazine(const magazine&) = delete;
+        magazine& operator=(const magazine&) = delete;
+
+        template <typename... Args>
+        T* construct(Args&&... args) {
+            if (count == 0) count = pool.take_slots(slots, capacity / 2);
+
+            slot* taken = slots[--count];
+            try {
+                return new (taken->storage) T(std::forward<Args>(args)...);
+            } catch (...) {
+                slots[count++] = taken;
+                throw;
+            }
+        }
+
+        void destroy(T* ptr) noexcept {
+            if (!ptr) return;
+            ptr->~T();
+
+            if (count == capacity) {
+                pool.give_slots(slots + capacity / 2, capacity / 2);
+                count = capacity / 2;
+            }
+            slots[count++] = reinterpret_cast<slot*>(ptr);
+        }
+    };
+}
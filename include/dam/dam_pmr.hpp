@@ -0,0 +1,201 @@
+#pragma once
+#include "dam.h"
+#include "dam_mutex.hpp"
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace dam {
+namespace pmr {
+    // The global DAM heap. Over-aligned requests go through dam_aligned_alloc() and dam_free().
+    class global_memory_resource final : public std::pmr::memory_resource {
+        static bool over_aligned(size_t alignment) noexcept { return alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__; }
+
+    protected:
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            if (!bytes) bytes = 1;
+            void* ptr = over_aligned(alignment) ? dam_aligned_alloc(alignment, bytes) : dam_malloc(bytes);
+            if (!ptr) throw std::bad_alloc();
+            return ptr;
+        }
+
+        void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+            if (over_aligned(alignment)) dam_free(ptr);
+            else dam_free_sized(ptr, bytes ? bytes : 1);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return dynamic_cast<const global_memory_resource*>(&other) != nullptr;
+        }
+    };
+
+    inline std::pmr::memory_resource* global_resource() noexcept {
+        static global_memory_resource resource;
+        return &resource;
+    }
+
+    /*
+     * Keeps a free list per DAM small size class and refills it from the central class lists
+     * (DAM_MALLOCX_NO_TCACHE), so an allocation is a list pop without a thread cache lookup.
+     * Bigger and over-aligned requests go upstream. release() returns every block, deallocated or not.
+     */
+    template <typename Mutex>
+    class basic_pool_resource : public std::pmr::memory_resource {
+        static constexpr size_t class_count = DAM_SIZE_CLASS_COUNT;
+        static constexpr size_t refill_count = 32;
+
+        struct free_block {
+            free_block* next;
+        };
+
+        struct large_block {
+            void* ptr;
+            size_t bytes;
+            size_t alignment;
+        };
+
+        std::pmr::memory_resource* upstream;
+        free_block* bins[class_count] = {};
+        std::pmr::vector<void*> blocks; // Every block taken from DAM
+        std::pmr::vector<large_block> large; // Live upstream allocations
+        Mutex mutex;
+
+        static constexpr size_t class_of(size_t bytes) noexcept {
+            return bytes <= DAM_SMALL_MIN ? 0 : 64 - __builtin_clzll(bytes - 1) - __builtin_ctzll(DAM_SMALL_MIN);
+        }
+
+        static constexpr bool is_pooled(size_t bytes, size_t alignment) noexcept {
+            return bytes <= DAM_SMALL_MAX && alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+        }
+
+        void push(size_t index, void* ptr) noexcept {
+            free_block* block = static_cast<free_block*>(ptr);
+            block->next = bins[index];
+            bins[index] = block;
+        }
+
+        void refill(size_t index) {
+            size_t size = size_t(DAM_SMALL_MIN) << index;
+            blocks.reserve(blocks.size() + refill_count);
+
+            for (size_t i = 0; i < refill_count; i++) {
+                void* ptr = dam_mallocx(size, DAM_MALLOCX_NO_TCACHE);
+                if (!ptr) break;
+                blocks.push_back(ptr);
+                push(index, ptr);
+            }
+
+            if (!bins[index]) throw std::bad_alloc();
+        }
+
+    public:
+        explicit basic_pool_resource(std::pmr::memory_resource* upstream = global_resource())
+            : upstream(upstream), blocks(upstream), large(upstream) {}
+
+        // release
+        ~basic_pool_resource() override { release(); }
+
+        // no copy
+        basic_pool_resource(const basic_pool_resource&) = delete;
+        basic_pool_resource& operator=(const basic_pool_resource&) = delete;
+
+        void release() noexcept {
+            std::lock_guard<Mutex> guard(mutex);
+
+            dam_free_batch(blocks.data(), blocks.size());
+            blocks.clear();
+            for (free_block*& bin : bins) bin = nullptr;
+
+            for (const large_block& block : large) upstream->deallocate(block.ptr, block.bytes, block.alignment);
+            large.clear();
+        }
+
+        std::pmr::memory_resource* upstream_resource() const noexcept { return upstream; }
+
+    protected:
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            if (!is_pooled(bytes, alignment)) {
+                void* ptr = upstream->allocate(bytes, alignment);
+                try {
+                    std::lock_guard<Mutex> guard(mutex);
+                    large.push_back({ ptr, bytes, alignment });
+                } catch (...) {
+                    upstream->deallocate(ptr, bytes, alignment);
+                    throw;
+                }
+                return ptr;
+            }
+
+            size_t index = class_of(bytes);
+            std::lock_guard<Mutex> guard(mutex);
+
+            if (!bins[index]) refill(index);
+            free_block* block = bins[index];
+            bins[index] = block->next;
+            return block;
+        }
+
+        void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+            if (is_pooled(bytes, alignment)) {
+                std::lock_guard<Mutex> guard(mutex);
+                push(class_of(bytes), ptr);
+                return;
+            }
+
+            {
+                // Newest first, containers tend to free what they allocated last.
+                std::lock_guard<Mutex> guard(mutex);
+                for (size_t i = large.size(); i-- > 0;) {
+                    if (large[i].ptr == ptr) {
+                        large[i] = large.back();
+                        large.pop_back();
+                        break;
+                    }
+                }
+            }
+            upstream->deallocate(ptr, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+
+    using synchronized_pool_resource = basic_pool_resource<std::mutex>;
+    using unsynchronized_pool_resource = basic_pool_resource<null_mutex>;
+
+    // Bump allocates from a dam_arena_t, deallocate is a no-op. release() rewinds and keeps the chunks.
+    class monotonic_resource : public std::pmr::memory_resource {
+        dam_arena_t* arena;
+
+    public:
+        explicit monotonic_resource(size_t chunk_size = 0) : arena(dam_arena_create(chunk_size)) {
+            if (!arena) throw std::bad_alloc();
+        }
+
+        // destroy
+        ~monotonic_resource() override { dam_arena_destroy(arena); }
+
+        // no copy
+        monotonic_resource(const monotonic_resource&) = delete;
+        monotonic_resource& operator=(const monotonic_resource&) = delete;
+
+        void release() noexcept { dam_arena_reset(arena); }
+
+    protected:
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            void* ptr = dam_arena_alloc_aligned(arena, bytes ? bytes : 1, alignment);
+            if (!ptr) throw std::bad_alloc();
+            return ptr;
+        }
+
+        void do_deallocate(void*, size_t, size_t) override {}
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    };
+}
+}
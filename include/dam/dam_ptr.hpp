@@ -1,20 +1,67 @@
 #pragma once
 #include "dam.h"
-#include <utility>
+#include <memory>
 #include <new>
+#include <type_traits>
+#include <utility>
 
 namespace dam {
+    // DAM small size class serving size bytes, only meaningful for size <= DAM_SMALL_MAX.
+    constexpr unsigned size_class_of(size_t size) noexcept {
+        return size <= DAM_SMALL_MIN ? 0 : unsigned(64 - __builtin_clzll(size - 1) - __builtin_ctzll(DAM_SMALL_MIN));
+    }
+
+    namespace detail {
+        /*
+         * Allocation path for n objects of T, picked at compile time. Single small objects go straight to
+         * their size class, the rest is freed sized. Over-aligned memory may sit in a bigger layer than its
+         * size and is freed unsized, so is a single object with a virtual destructor, it may be a bigger derived type.
+         */
+        template <typename T>
+        struct storage {
+            static constexpr bool over_aligned = alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+            static constexpr bool class_path = !over_aligned && sizeof(T) <= DAM_SMALL_MAX;
+
+            static T* allocate(size_t n) noexcept {
+                size_t size = n * sizeof(T);
+                if constexpr (over_aligned) return static_cast<T*>(dam_aligned_alloc(alignof(T), size));
+                else return static_cast<T*>(dam_malloc(size));
+            }
+
+            static void deallocate(T* ptr, size_t n) noexcept {
+                if constexpr (over_aligned) dam_free(ptr);
+                else dam_free_sized(ptr, n * sizeof(T));
+            }
+
+            static T* allocate_one() noexcept {
+                if constexpr (class_path) return static_cast<T*>(dam_class_malloc(size_class_of(sizeof(T))));
+                else return allocate(1);
+            }
+
+            static void deallocate_one(T* ptr) noexcept {
+                if constexpr (std::has_virtual_destructor<T>::value) dam_free(ptr);
+                else if constexpr (class_path) dam_class_free(ptr, size_class_of(sizeof(T)));
+                else deallocate(ptr, 1);
+            }
+        };
+    }
+
+    // Owns one T. A raw pointer handed in must come from make_unique() or dam_malloc(sizeof(T)).
     template <typename T>
     class unique_ptr {
         T* ptr;
 
+        static void destroy(T* p) noexcept {
+            if (!p) return;
+            p->~T();
+            detail::storage<T>::deallocate_one(p);
+        }
+
     public:
         explicit unique_ptr(T* p = nullptr) noexcept : ptr(p) {}
 
-        // free
-        ~unique_ptr() noexcept {
-            if (ptr) dam_free(ptr);
-        }
+        // destroy
+        ~unique_ptr() noexcept { destroy(ptr); }
 
         // no copy
         unique_ptr(const unique_ptr&) = delete;
@@ -26,7 +73,7 @@ namespace dam {
         }
         unique_ptr& operator=(unique_ptr&& other) noexcept {
             if (this != &other) {
-                if (ptr) dam_free(ptr);
+                destroy(ptr);
                 ptr = other.ptr;
                 other.ptr = nullptr;
             }
@@ -40,8 +87,9 @@ namespace dam {
         }
 
         void reset(T* p = nullptr) noexcept {
-            if (ptr) dam_free(ptr);
+            T* old = ptr;
             ptr = p;
+            destroy(old);
         }
 
         T* get() const { return ptr; }
@@ -51,35 +99,81 @@ namespace dam {
         explicit operator bool() const noexcept { return ptr != nullptr; }
     };
 
+    // Returns an empty pointer when DAM is out of memory, exceptions from the constructor propagate.
     template<typename T, typename... Args>
     typename std::enable_if<!std::is_array<T>::value, unique_ptr<T>>::type
     make_unique(Args&&... args) {
-        T* ptr = static_cast<T*>(dam_malloc(sizeof(T)));
+        T* ptr = detail::storage<T>::allocate_one();
         if (!ptr) return unique_ptr<T>(nullptr);
-        new (ptr) T(std::forward<Args>(args)...);
+
+        try {
+            new (ptr) T(std::forward<Args>(args)...);
+        } catch (...) {
+            detail::storage<T>::deallocate_one(ptr);
+            throw;
+        }
         return unique_ptr<T>(ptr);
     }
 
+    // Owns n constructed T. A raw pointer handed in must come from make_unique() or dam_malloc(n * sizeof(T)).
     template <typename T>
     class unique_ptr<T[]> {
+        using storage = detail::storage<T>;
+
         T* ptr;
         size_t size;
 
+        static void destroy(T* p, size_t n) noexcept {
+            if (!p) return;
+            std::destroy_n(p, n);
+            storage::deallocate(p, n);
+        }
+
     public:
         explicit unique_ptr(T* p = nullptr, const size_t n = 0) noexcept : ptr(p), size(n) {}
 
-        // realloc
+        /*
+         * Destroys or value-initializes the tail. Trivially copyable elements are moved by dam_realloc(),
+         * which keeps the layer matching the new size, so the sized free in the destructor still routes.
+         * Others are moved into a new allocation and should not throw while doing so.
+         */
         bool resize(size_t new_count) {
-            void* new_ptr = dam_realloc(ptr, sizeof(T) * new_count);
-            if (!new_ptr) return false;
-            ptr = static_cast<T*>(new_ptr);
+            if (new_count == size) return true;
+
+            if (new_count == 0) {
+                destroy(ptr, size);
+                ptr = nullptr;
+                size = 0;
+                return true;
+            }
+
+            if constexpr (std::is_trivially_copyable<T>::value && !storage::over_aligned) {
+                T* new_ptr = static_cast<T*>(dam_realloc(ptr, sizeof(T) * new_count));
+                if (!new_ptr) return false;
+                if (new_count > size) std::uninitialized_value_construct(new_ptr + size, new_ptr + new_count);
+                ptr = new_ptr;
+            } else {
+                T* new_ptr = storage::allocate(new_count);
+                if (!new_ptr) return false;
+
+                size_t kept = size < new_count ? size : new_count;
+                try {
+                    std::uninitialized_value_construct(new_ptr + kept, new_ptr + new_count);
+                } catch (...) {
+                    storage::deallocate(new_ptr, new_count);
+                    throw;
+                }
+                std::uninitialized_move_n(ptr, kept, new_ptr);
+                destroy(ptr, size);
+                ptr = new_ptr;
+            }
+
+            size = new_count;
             return true;
         }
 
-        // free
-        ~unique_ptr() noexcept {
-            if (ptr) dam_free(ptr);
-        }
+        // destroy
+        ~unique_ptr() noexcept { destroy(ptr, size); }
 
         // no copy
         unique_ptr(const unique_ptr&) = delete;
@@ -92,7 +186,7 @@ namespace dam {
         }
         unique_ptr& operator=(unique_ptr&& other) noexcept {
             if (this != &other) {
-                if (ptr) dam_free(ptr);
+                destroy(ptr, size);
                 ptr = other.ptr;
                 size = other.size;
                 other.ptr = nullptr;
@@ -109,9 +203,11 @@ namespace dam {
         }
 
         void reset(T* p = nullptr, const size_t n = 0) noexcept {
-            if (ptr) dam_free(ptr);
+            T* old = ptr;
+            size_t old_size = size;
             ptr = p;
             size = n;
+            destroy(old, old_size);
         }
 
         T* get() const { return ptr; }
@@ -124,9 +220,15 @@ namespace dam {
     typename std::enable_if<std::is_array<T>::value, unique_ptr<T>>::type
     make_unique(size_t size) {
         using Elem = typename std::remove_extent<T>::type;
-        Elem* ptr = static_cast<Elem*>(dam_malloc(sizeof(Elem) * size));
+        Elem* ptr = detail::storage<Elem>::allocate(size);
         if (!ptr) return unique_ptr<T>(nullptr, 0);
-        for (size_t i = 0; i < size; i++) new (ptr + i) Elem();
+
+        try {
+            std::uninitialized_value_construct_n(ptr, size);
+        } catch (...) {
+            detail::storage<Elem>::deallocate(ptr, size);
+            throw;
+        }
         return unique_ptr<T>(ptr, size);
     }
 }
@@ -0,0 +1,296 @@
+#pragma once
+#include "dam.h"
+#include <algorithm>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace dam {
+    /*
+     * Whether a T can be moved to another address with memcpy() and without running its destructor.
+     * Defaults to trivially copyable types, specialize it for types that only own heap memory, e.g. a pimpl pointer.
+     */
+    template <typename T>
+    struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+    /*
+     * Contiguous container on the DAM heap. Trivially relocatable elements grow through dam_realloc(), which
+     * extends general blocks in place and mremap()s direct mappings, so appending to a large vector does not copy.
+     * Capacity is read back with dam_usable_size(), growth first fills whatever slack the block already has.
+     */
+    template <typename T>
+    class vector {
+        static constexpr bool over_aligned = alignof(T) > __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+        // dam_realloc() only keeps the default alignment.
+        static constexpr bool relocates = is_trivially_relocatable<T>::value && !over_aligned;
+
+        T* items = nullptr;
+        size_t count = 0;
+        size_t slots = 0;
+
+        static size_t bytes_for(size_t n) {
+            if (n > std::numeric_limits<size_t>::max() / sizeof(T)) throw std::bad_array_new_length();
+            return n * sizeof(T);
+        }
+
+        static size_t slots_in(T* ptr, size_t requested) noexcept {
+            if constexpr (over_aligned) return requested;
+            else return dam_usable_size(ptr) / sizeof(T);
+        }
+
+        static T* allocate(size_t n) {
+            size_t bytes = bytes_for(n);
+            void* ptr = over_aligned ? dam_aligned_alloc(alignof(T), bytes) : dam_malloc(bytes);
+            if (!ptr) throw std::bad_alloc();
+            return static_cast<T*>(ptr);
+        }
+
+        // The capacity comes from the usable size, which does not have to match the layer of the requested size.
+        static void deallocate(T* ptr) noexcept { dam_free(ptr); }
+
+        size_t grown_capacity(size_t needed) const {
+            if (needed > max_size()) throw std::length_error("dam::vector too long");
+            return std::max(needed, slots > max_size() / 2 ? max_size() : slots * 2);
+        }
+
+        // Moves the elements into a block of at least new_slots slots, count must fit.
+        void reallocate(size_t new_slots) {
+            if constexpr (relocates) {
+                T* new_items = static_cast<T*>(dam_realloc(items, bytes_for(new_slots)));
+                if (!new_items) throw std::bad_alloc();
+                items = new_items;
+            } else {
+                T* new_items = allocate(new_slots);
+                try {
+                    move_into(new_items);
+                } catch (...) {
+                    deallocate(new_items);
+                    throw;
+                }
+                deallocate(items);
+                items = new_items;
+            }
+            slots = slots_in(items, new_slots);
+        }
+
+        // Moves the elements to to and destroys the originals. If a copy throws nothing is destroyed.
+        void move_into(T* to) {
+            size_t moved = 0;
+            try {
+                for (; moved < count; moved++) new (to + moved) T(std::move_if_noexcept(items[moved]));
+            } catch (...) {
+                std::destroy_n(to, moved);
+                throw;
+            }
+            std::destroy_n(items, count);
+        }
+
+        // Grows for one more element built from args, which may refer to an element of this vector.
+        template <typename... Args>
+        T& grow_emplace(Args&&... args) {
+            size_t new_slots = grown_capacity(count + 1);
+
+            if constexpr (relocates) {
+                alignas(T) unsigned char staged[sizeof(T)];
+                T* value = new (staged) T(std::forward<Args>(args)...);
+                try {
+                    reallocate(new_slots);
+                } catch (...) {
+                    value->~T();
+                    throw;
+                }
+                std::memcpy(static_cast<void*>(items + count), staged, sizeof(T));
+            } else {
+                T* new_items = allocate(new_slots);
+                try {
+                    new (new_items + count) T(std::forward<Args>(args)...);
+                } catch (...) {
+                    deallocate(new_items);
+                    throw;
+                }
+                try {
+                    move_into(new_items);
+                } catch (...) {
+                    new_items[count].~T();
+                    deallocate(new_items);
+                    throw;
+                }
+                deallocate(items);
+                items = new_items;
+                slots = slots_in(items, new_slots);
+            }
+            return items[count++];
+        }
+
+        // Only for constructors, the destructor does not run when they throw.
+        void copy_from(const T* from, size_t n) {
+            if (n == 0) return;
+            items = allocate(n);
+            try {
+                std::uninitialized_copy_n(from, n, items);
+            } catch (...) {
+                deallocate(items);
+                throw;
+            }
+            count = n;
+            slots = slots_in(items, n);
+        }
+
+        // Only for constructors, like copy_from().
+        template <typename... Args>
+        void fill_from(size_t n, const Args&... value) {
+            try {
+                resize_with(n, value...);
+            } catch (...) {
+                deallocate(items);
+                throw;
+            }
+        }
+
+        template <typename... Args>
+        void resize_with(size_t n, const Args&... value) {
+            if (n < count) {
+                std::destroy(items + n, items + count);
+                count = n;
+                return;
+            }
+            if (n > slots) reallocate(grown_capacity(n));
+
+            if constexpr (sizeof...(Args) == 0) std::uninitialized_value_construct(items + count, items + n);
+            else std::uninitialized_fill(items + count, items + n, value...);
+            count = n;
+        }
+
+    public:
+        using value_type = T;
+        using size_type = size_t;
+        using difference_type = std::ptrdiff_t;
+        using reference = T&;
+        using const_reference = const T&;
+        using pointer = T*;
+        using const_pointer = const T*;
+        using iterator = T*;
+        using const_iterator = const T*;
+
+        vector() noexcept = default;
+        explicit vector(size_t n) { fill_from(n); }
+        vector(size_t n, const T& value) { fill_from(n, value); }
+        vector(std::initializer_list<T> values) { copy_from(values.begin(), values.size()); }
+
+        // destroy
+        ~vector() noexcept {
+            std::destroy(items, items + count);
+            deallocate(items);
+        }
+
+        // copy
+        vector(const vector& other) { copy_from(other.items, other.count); }
+        vector& operator=(const vector& other) {
+            if (this != &other) {
+                vector copy(other);
+                swap(copy);
+            }
+            return *this;
+        }
+
+        // move
+        vector(vector&& other) noexcept : items(other.items), count(other.count), slots(other.slots) {
+            other.items = nullptr;
+            other.count = 0;
+            other.slots = 0;
+        }
+        vector& operator=(vector&& other) noexcept {
+            if (this != &other) {
+                vector moved(std::move(other));
+                swap(moved);
+            }
+            return *this;
+        }
+
+        void swap(vector& other) noexcept {
+            std::swap(items, other.items);
+            std::swap(count, other.count);
+            std::swap(slots, other.slots);
+        }
+
+        template <typename... Args>
+        T& emplace_back(Args&&... args) {
+            if (count == slots) return grow_emplace(std::forward<Args>(args)...);
+            new (items + count) T(std::forward<Args>(args)...);
+            return items[count++];
+        }
+
+        void push_back(const T& value) { emplace_back(value); }
+        void push_back(T&& value) { emplace_back(std::move(value)); }
+
+        void pop_back() noexcept { items[--count].~T(); }
+
+        void clear() noexcept {
+            std::destroy(items, items + count);
+            count = 0;
+        }
+
+        void reserve(size_t n) {
+            if (n > max_size()) throw std::length_error("dam::vector too long");
+            if (n > slots) reallocate(n);
+        }
+
+        void resize(size_t n) { resize_with(n); }
+        void resize(size_t n, const T& value) {
+            // value may be an element, a reallocation would leave it dangling.
+            if (n > slots) {
+                T copy(value);
+                resize_with(n, copy);
+            } else {
+                resize_with(n, value);
+            }
+        }
+
+        // Relocating vectors shrink in place with dam_realloc(), the rest moves into a block that fits.
+        void shrink_to_fit() {
+            if (slots == count || over_aligned) return;
+
+            if (count == 0) {
+                deallocate(items);
+                items = nullptr;
+                slots = 0;
+                return;
+            }
+            reallocate(count);
+        }
+
+        T* data() noexcept { return items; }
+        const T* data() const noexcept { return items; }
+        size_t size() const noexcept { return count; }
+        size_t capacity() const noexcept { return slots; }
+        bool empty() const noexcept { return count == 0; }
+        static constexpr size_t max_size() noexcept { return std::numeric_limits<size_t>::max() / sizeof(T); }
+
+        T& operator[](size_t i) noexcept { return items[i]; }
+        const T& operator[](size_t i) const noexcept { return items[i]; }
+
+        T& at(size_t i) {
+            if (i >= count) throw std::out_of_range("dam::vector index out of range");
+            return items[i];
+        }
+        const T& at(size_t i) const {
+            if (i >= count) throw std::out_of_range("dam::vector index out of range");
+            return items[i];
+        }
+
+        T& front() noexcept { return items[0]; }
+        const T& front() const noexcept { return items[0]; }
+        T& back() noexcept { return items[count - 1]; }
+        const T& back() const noexcept { return items[count - 1]; }
+
+        T* begin() noexcept { return items; }
+        const T* begin() const noexcept { return items; }
+        T* end() noexcept { return items + count; }
+        const T* end() const noexcept { return items + count; }
+    };
+}
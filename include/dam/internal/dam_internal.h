@@ -10,41 +10,57 @@ void dam_thread_init(void);
 thread_cache_t* dam_get_thread_cache(void);
 void dam_thread_cache_destroy(void);
 thread_cache_t* dam_get_current_thread_cache(void);
+uint8_t dam_deferred_free_push(void* ptr);
+uint8_t dam_try_free(void* ptr);
 
 // Diagnostic API
 void dam_snapshot_small(dam_snapshot_t* snapshot);
 void dam_snapshot_general(dam_snapshot_t* snapshot);
+void dam_snapshot_span(dam_snapshot_t* snapshot);
 void dam_snapshot_direct(dam_snapshot_t* snapshot);
 void dam_general_fragmentation(pool_header_t* pool, dam_pool_fragmentation_t* snapshot);
 void dam_general_pressure(pool_header_t* pool, dam_pool_pressure_t* snapshot);
 uint8_t dam_validate_small_ptr(void* ptr, size_class_header_t* size_class_header);
 uint8_t dam_validate_general_ptr(void* ptr, pool_header_t* pool_header, uint8_t quarantine, block_header_t* block_header);
+uint8_t dam_validate_span_ptr(void* ptr, pool_header_t* pool_header);
 uint8_t dam_validate_direct_ptr(void* ptr, const block_header_t* direct_header);
 
 /* Helpers */
 void dam_register_pool(pool_header_t* new_pool_header);
 void dam_unregister_pool(pool_header_t* pool_header);
-pool_header_t* create_general_pool(size_t min_size);
+pool_header_t* create_general_pool(dam_heap_t* heap, size_t min_size);
 block_header_t* find_block_in_pools(size_t actual_size, pool_header_t** found_pool);
 void split_block_if_possible(block_header_t* block_header, size_t actual_size);
+size_t aligned_payload_offset(const block_header_t* block_header, size_t alignment);
+block_header_t* split_block_aligned(block_header_t* block_header, size_t alignment);
 block_header_t* coalesce_if_possible(block_header_t* block_header, pool_header_t* pool_header);
 uint32_t* dam_get_general_canary(void* ptr, block_header_t* block_header);
 void general_pool_quarantine(pool_header_t* pool_header);
 size_t align_up(size_t size, size_t alignment);
 int verify_page_size(void);
+void* dam_map_aligned(size_t size, size_t alignment);
+void* dam_map_pool(size_t size, uint8_t* is_huge);
+void* dam_map_hugetlb(size_t size);
+uint8_t dam_advise_huge(void* memory, size_t size);
+uint8_t dam_madvise_huge(void* memory, size_t size);
+uint8_t dam_huge_page_policy_has(unsigned flag);
+uint64_t dam_now_ms(void);
 pool_header_t* dam_pool_from_ptr(void* ptr);
+uint8_t dam_pool_contains(const pool_header_t* pool_header, const void* ptr);
+void dam_memory_init(void);
+void* dam_memcpy(void* dst, const void* src, size_t size);
+void* dam_memzero(void* dst, size_t size);
 size_class_header_t* get_size_class_header(void* ptr);
 size_class_header_t* get_size_class_trace_header(void* ptr);
+size_t dam_small_usable_size(void* ptr, const size_class_header_t* size_class_header);
 block_header_t* get_block_header(void* ptr);
 block_header_t* get_block_trace_header(void* ptr);
-pool_header_t* direct_pool_from_ptr(void* ptr);
-block_header_t* get_direct_header(void* ptr);
-block_header_t* get_direct_trace_header(void* ptr);
+block_header_t* get_direct_header(pool_header_t* pool_header);
 size_t class_to_size(uint8_t class_index);
 uint8_t size_to_class(size_t size, uint8_t traced);
 void add_to_free_list(pool_header_t*, block_header_t* block_header);
-block_header_t* search_in_free_list(pool_header_t* pool_header, size_t actual_size);
-block_header_t* find_free_block_in_pools(pool_header_t** pool_header, size_t actual_size);
+block_header_t* search_in_free_list(pool_header_t* pool_header, size_t actual_size, size_t alignment);
+block_header_t* find_free_block_in_pools(dam_heap_t* heap, pool_header_t** pool_header, size_t actual_size, size_t alignment);
 void remove_from_free_list(pool_header_t* pool_header, block_header_t* block_header);
 free_block_header_t* get_free_block_header(block_header_t* block_header);
 
@@ -52,19 +68,50 @@ free_block_header_t* get_free_block_header(block_header_t* block_header);
 /* allocator entry points */
 void dam_small_init(void);
 void dam_general_init(void);
+void dam_span_init(void);
 void dam_direct_init(void);
 
 void* dam_small_malloc(size_t size, const char* trace);
 void* dam_general_malloc(size_t size, const char* trace);
+void* dam_span_malloc(size_t size, const char* trace);
 void* dam_direct_malloc(size_t size, const char* trace);
 
+void* dam_small_malloc_from_central(size_t size, const char* trace);
+void* dam_small_class_malloc(uint8_t class_index);
+void dam_small_class_free(void* ptr, size_class_header_t* size_class_header, uint8_t class_index);
+void dam_small_flush_thread_cache(thread_cache_t* thread_cache);
+void* dam_small_align_block(void* ptr, size_t alignment);
+void* dam_general_malloc_aligned(size_t size, size_t alignment);
+
+size_t dam_small_malloc_batch(size_t size, size_t count, void** out);
+size_t dam_general_malloc_batch(size_t size, size_t count, void** out);
+size_t dam_span_malloc_batch(size_t size, size_t count, void** out);
+size_t dam_direct_malloc_batch(size_t size, size_t count, void** out);
+
+void dam_small_free_batch(void** ptrs, size_t count);
+void dam_general_free_batch(void** ptrs, pool_header_t** pools, size_t count);
+void dam_span_free_batch(void** ptrs, pool_header_t** pools, size_t count);
+void dam_direct_free_batch(void** ptrs, size_t count);
+
+size_t dam_general_usable_size(void* ptr, const block_header_t* block_header);
+size_t dam_span_usable_size(void* ptr, pool_header_t* pool_header);
+size_t dam_direct_usable_size(void* ptr, pool_header_t* pool_header);
+size_t dam_general_commit_usable(void* ptr, block_header_t* block_header);
+size_t dam_span_commit_usable(void* ptr, pool_header_t* pool_header);
+size_t dam_direct_commit_usable(void* ptr, pool_header_t* pool_header);
+void* dam_span_mallocx(size_t size, int flags);
+void* dam_direct_mallocx(size_t size, int flags);
+void* dam_direct_clone(void* ptr, pool_header_t* pool_header);
+
 void dam_small_free(void* ptr, size_class_header_t* size_class_header);
 void dam_general_free(void* ptr, pool_header_t* pool_header, block_header_t* block_header);
+void dam_span_free(void* ptr, pool_header_t* pool_header);
 void dam_direct_free(void* ptr);
 
 void* dam_small_realloc(void* ptr, size_t size, size_class_header_t* size_class_header, const char* trace);
 void* dam_general_realloc(void* ptr, size_t size, block_header_t* block_header, const char* trace);
-void* dam_direct_realloc(void* ptr, size_t size, const block_header_t* direct_header, const char* trace);
+void* dam_span_realloc(void* ptr, size_t size, pool_header_t* pool_header, const char* trace);
+void* dam_direct_realloc(void* ptr, size_t size, block_header_t* direct_header, const char* trace);
 
 // Multi-threading
 void dam_small_lock(void);
@@ -73,15 +120,57 @@ void dam_small_unlock(void);
 void dam_general_lock(void);
 void dam_general_unlock(void);
 
+void dam_span_lock(void);
+void dam_span_unlock(void);
+
 void dam_direct_lock(void);
 void dam_direct_unlock(void);
 
+void dam_pool_list_read_lock(void);
+void dam_pool_list_write_lock(void);
+void dam_pool_list_unlock(void);
+
 void* dam_small_malloc_internal(size_t size, const char* trace);
-void* dam_general_malloc_internal(size_t size, const char* trace);
-void* dam_direct_malloc_internal(size_t size, const char* trace);
+void* dam_general_malloc_internal(size_t size, const char* trace, size_t alignment);
+void* dam_span_malloc_internal(size_t size, const char* trace, size_t alignment);
+void* dam_direct_malloc_internal(size_t size, const char* trace, int flags);
 
 void dam_small_free_internal(void* ptr, size_class_header_t* size_class_header);
 void dam_general_free_internal(void* ptr, pool_header_t* pool_header, block_header_t* block_header);
+void dam_span_free_internal(void* ptr, pool_header_t* pool_header);
 void dam_direct_free_internal(void* ptr);
 
+// Heaps, called with the heap lock held
+void dam_small_heap_init(dam_heap_t* heap);
+void* dam_small_heap_malloc(dam_heap_t* heap, size_t size);
+void dam_small_heap_free(dam_heap_t* heap, void* ptr, size_class_header_t* size_class_header);
+void* dam_general_heap_malloc(dam_heap_t* heap, size_t size);
+
+// Regions, offset based heaps for shared and persistent memory
+uint8_t dam_region_init(dam_region_header_t* region, size_t size);
+uint8_t dam_region_validate(const dam_region_header_t* region, size_t mapped_size);
+uint8_t dam_region_check(dam_region_header_t* region);
+uint8_t dam_region_reset_lock(dam_region_header_t* region);
+uint8_t dam_region_lock(dam_region_header_t* region);
+void dam_region_unlock(dam_region_header_t* region);
+void* dam_region_malloc(dam_region_header_t* region, size_t size);
+void dam_region_free(dam_region_header_t* region, void* ptr);
+dam_offset_t dam_region_offset(const dam_region_header_t* region, const void* ptr);
+void* dam_region_ptr(dam_region_header_t* region, dam_offset_t offset);
+
+// Span helpers
+span_chunk_t* span_chunk_from_ptr(void* ptr);
+span_entry_t* get_span_entry(void* ptr, span_chunk_t* span_chunk);
+
+// Direct mapping cache
+void* direct_cache_take(size_t size, pool_header_t* pool_header);
+uint8_t direct_cache_put(const pool_header_t* pool_header);
+
+// Reservations
+uint8_t dam_prefault(void* memory, size_t size, unsigned flags);
+uint8_t dam_small_reserve(uint8_t class_index, size_t bytes, unsigned flags);
+uint8_t dam_general_reserve(size_t bytes, unsigned flags);
+uint8_t dam_span_reserve(size_t bytes, unsigned flags);
+uint8_t dam_direct_reserve(size_t bytes, unsigned flags);
+
 #include "dam/internal/dam_invariants.h"
\ No newline at end of file
@@ -15,6 +15,12 @@ _Static_assert((DAM_SMALL_MIN & DAM_SMALL_MIN - 1) == 0, "DAM_SMALL_MIN must be
 _Static_assert((DAM_SMALL_MAX & DAM_SMALL_MAX - 1) == 0, "DAM_SMALL_MAX must be power of two");
 _Static_assert(DAM_SMALL_MIN <= DAM_SMALL_MAX, "Invalid size class range");
 _Static_assert(DAM_SMALL_MAX <= DAM_GENERAL_MAX, "Invalid allocator boundaries");
+_Static_assert(DAM_GENERAL_MAX < DAM_SPAN_MAX, "Invalid allocator boundaries");
+_Static_assert((DAM_SPAN_CHUNK_SIZE & DAM_SPAN_CHUNK_SIZE - 1) == 0, "DAM_SPAN_CHUNK_SIZE must be power of two");
+_Static_assert(DAM_SPAN_MAX <= DAM_SPAN_CHUNK_SIZE / 2, "A maximum span must fit in a chunk next to its metadata");
+_Static_assert(DAM_SPAN_CHUNK_PAGES % 64 == 0, "Span bitmap works in whole 64 page words");
+_Static_assert(HUGE_PAGE_SIZE % PAGE_SIZE == 0, "HUGE_PAGE_SIZE must be a multiple of PAGE_SIZE");
+_Static_assert(DAM_SPAN_CHUNK_SIZE % HUGE_PAGE_SIZE == 0, "Span chunks must be made of whole huge pages");
 _Static_assert(DAM_SIZE_CLASS_COUNT <= 255, "Bigger than 255 would overflow class header with an extra byte.");
 _Static_assert(sizeof(SMALL_MAGIC) <= sizeof(uint32_t), "SMALL_MAGIC too large for size_class_header");
 _Static_assert(sizeof(SMALL_FREED_MAGIC) <= sizeof(uint32_t), "SMALL_FREED_MAGIC too large for size_class_header");
\ No newline at end of file
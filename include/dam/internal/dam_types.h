@@ -1,4 +1,5 @@
 #pragma once
+#include <pthread.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -12,8 +13,44 @@ typedef enum {
     DAM_LAYER_SMALL,
     DAM_LAYER_GENERAL,
     DAM_LAYER_DIRECT,
+    DAM_LAYER_SPAN, // Sits between general and direct, appended to keep the values above stable.
 } dam_layer_type_t;
 
+typedef enum {
+    DAM_HUGE_PAGE_NONE        = 0,
+    DAM_HUGE_PAGE_MADVISE     = 1 << 0, // 2 MiB align pools and madvise(MADV_HUGEPAGE) them
+    DAM_HUGE_PAGE_HUGETLB     = 1 << 1, // MAP_HUGETLB for direct allocations, falls back to regular pages
+    DAM_HUGE_PAGE_ROUND_POOLS = 1 << 2, // Size general pools in whole huge pages
+} dam_huge_page_policy_t;
+
+// How a pool is backed, stored in pool_header_t::is_huge.
+#define DAM_HUGE_BACKING_NONE 0
+#define DAM_HUGE_BACKING_THP 1
+#define DAM_HUGE_BACKING_HUGETLB 2
+
+typedef enum {
+    DAM_RESERVE_POPULATE = 1 << 0, // Fault every page in now (MADV_POPULATE_WRITE, Linux 5.14+)
+    DAM_RESERVE_WILLNEED = 1 << 1, // madvise(MADV_WILLNEED)
+    DAM_RESERVE_LOCK     = 1 << 2, // mlock() the memory so it is never paged out
+} dam_reserve_flags_t;
+
+// dam_mallocx() / dam_reallocx() flags. The low 6 bits hold log2 of the requested alignment.
+#define DAM_MALLOCX_LG_ALIGN(lg) ((int)(lg))
+#define DAM_MALLOCX_ALIGN(a) ((int)__builtin_ctzll(a))
+#define DAM_MALLOCX_ALIGN_MASK 0x3f
+#define DAM_MALLOCX_ALIGNMENT(flags) (((flags) & DAM_MALLOCX_ALIGN_MASK) ? (size_t)1 << ((flags) & DAM_MALLOCX_ALIGN_MASK) : 0)
+#define DAM_MALLOCX_ZERO (1 << 6)       // Memory is zeroed (for reallocx: bytes past the old size)
+#define DAM_MALLOCX_POPULATE (1 << 7)   // Pages the allocation owns are faulted in before returning
+#define DAM_MALLOCX_HUGE (1 << 8)       // Prefer huge page backing, regardless of the huge page policy
+#define DAM_MALLOCX_NO_TCACHE (1 << 9)  // Small allocations bypass the thread cache
+#define DAM_MALLOCX_CLONEABLE (1 << 10) // Direct allocations are memfd backed, so dam_clone() shares their pages
+
+// dam_reserve() targets, small size classes are addressed by their class index.
+#define DAM_RESERVE_CLASS(index) ((int)(index))
+#define DAM_RESERVE_GENERAL (-(int)DAM_LAYER_GENERAL)
+#define DAM_RESERVE_SPAN (-(int)DAM_LAYER_SPAN)
+#define DAM_RESERVE_DIRECT (-(int)DAM_LAYER_DIRECT)
+
 typedef struct size_class_header {
     uint32_t magic;
     uint8_t size_class_index;
@@ -36,6 +73,7 @@ typedef struct block_header {
     uint32_t magic;
     uint8_t is_free;
     uint8_t is_traced;
+    uint8_t is_zero; // Payload past its first FREE_BLOCK_HEADER_SIZE bytes was never written
 } block_header_t;
 
 typedef struct free_block_header {
@@ -49,17 +87,125 @@ typedef struct pool_header {
     dam_layer_type_t type;
     uint8_t read_only;
     uint8_t has_free;
+    uint8_t is_huge;
+    uint8_t is_pinned;
     struct pool_header* next;
     block_header_t* block_list;
     block_header_t* free_list;
+    void* zero_mark; // General pools: past it only free block metadata was ever written
+    struct dam_heap* heap; // Owning heap, NULL for the global one
+    struct pool_header* heap_next; // Next pool of the same heap
 } pool_header_t;
 
+// Metadata of one span, indexed by its first page.
+typedef struct span_entry {
+    uint32_t magic;
+    uint32_t pages;
+    uint32_t user_size;
+    uint8_t is_free;
+    uint8_t is_traced;
+    uint8_t is_zero;
+    uint8_t padding;
+} span_entry_t;
+
+// Lives at the start of every span chunk, the chunk is aligned to its own size.
+typedef struct span_chunk {
+    pool_header_t pool;
+    struct span_chunk* next;
+    size_t first_page;
+    size_t free_pages;
+    uint8_t is_pinned;
+    uint64_t used[DAM_SPAN_CHUNK_PAGES / 64];
+    uint64_t dirty[DAM_SPAN_CHUNK_PAGES / 64]; // Pages that were ever handed out
+    span_entry_t spans[DAM_SPAN_CHUNK_PAGES];
+} span_chunk_t;
+
+// Out-of-line metadata of one direct mapping, handed out from header slabs.
+typedef struct direct_header {
+    pool_header_t pool;
+    block_header_t block;
+    int fd; // memfd backing the mapping, -1 for anonymous memory
+    uint8_t is_snapshot; // Mapped MAP_PRIVATE, writes no longer reach the memfd
+} direct_header_t;
+
+// Lives at the start of every arena chunk, the bump region follows it.
+typedef struct dam_arena_chunk {
+    struct dam_arena_chunk* next;
+    size_t size; // Whole chunk, header included
+} dam_arena_chunk_t;
+
+// Bump allocator over a list of chunks, chunks stay in place across resets and are reused in order.
+typedef struct dam_arena {
+    dam_arena_chunk_t* chunks;
+    dam_arena_chunk_t* current;
+    char* cursor;
+    char* end;
+    size_t chunk_size;
+} dam_arena_t;
+
+// Lives at the start of a cached (freed, but still mapped) direct mapping.
+typedef struct direct_cache_entry {
+    size_t size;
+    uint64_t cached_at;
+    uint8_t is_huge;
+    uint8_t is_pinned;
+    struct direct_cache_entry* prev;
+    struct direct_cache_entry* next;
+} direct_cache_entry_t;
+
 typedef struct size_class {
     size_t block_size;
     size_class_header_t* free_class_list;
     pool_header_t* pools;
 } size_class_t;
 
+// Regions (shared and persistent heaps) link their metadata by offset from the region start, never by pointer.
+typedef uint64_t dam_offset_t;
+
+typedef struct dam_region_block {
+    uint64_t size; // Payload bytes
+    dam_offset_t prev; // Physically previous block, 0 for the first
+    dam_offset_t next_free;
+    dam_offset_t prev_free;
+    uint32_t magic;
+    uint8_t is_free;
+} dam_region_block_t;
+
+// Lives at offset 0 of every region, the lock is process shared and robust.
+typedef struct dam_region_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size; // Whole region, header included
+    pthread_mutex_t lock;
+    dam_offset_t first_block;
+    dam_offset_t free_list;
+    uint64_t bytes_used;
+    dam_offset_t root; // Entry point a persistent heap hands back on reopen
+    uint8_t is_dirty; // Persistent heaps: open, or not closed cleanly
+} dam_region_header_t;
+
+// Process local handle of a shared heap, every process maps the region at its own address.
+typedef struct dam_shared_heap {
+    dam_region_header_t* region;
+    size_t size;
+    int fd;
+} dam_shared_heap_t;
+
+// Process local handle of a file backed heap.
+typedef struct dam_persistent_heap {
+    dam_region_header_t* region;
+    size_t size;
+    int fd;
+} dam_persistent_heap_t;
+
+// Isolated heap, its pools serve nobody else and are unmapped together on destroy.
+typedef struct dam_heap {
+    uint32_t magic;
+    pthread_mutex_t lock;
+    size_class_t size_classes[DAM_SIZE_CLASS_COUNT];
+    pool_header_t* pools; // Small and general pools, linked through heap_next
+} dam_heap_t;
+
 typedef struct {
     size_class_header_t* free_list;
     size_t count;
@@ -79,8 +225,14 @@ typedef struct {
     size_t pools_active;
     size_t pools_bytes_used;
     size_t quarantined_pools;
+    size_t span_chunks;
+    size_t span_bytes_mapped;
+    size_t span_bytes_used;
     size_t direct_allocations;
     size_t direct_bytes_used;
+    size_t direct_cached_mappings;
+    size_t direct_cached_bytes;
+    size_t huge_page_bytes;
 } dam_snapshot_t;
 
 typedef struct {
@@ -0,0 +1,137 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dam/dam.h"
+#include "dam/dam_config.h"
+#include "dam/dam_log.h"
+#include "dam/internal/dam_internal.h"
+
+/**********************************************************
+ * Arena allocator
+ *
+ * dam_arena_t
+ * ├─ chunks               ← linked list (all chunks, in use order)
+ * ├─ current              ← chunk being bumped
+ * └─ cursor .. end        ← free tail of current
+ *
+ * Chunks come from dam_malloc(), so the default chunk lands in the
+ * general layer and oversized ones in span or direct. Objects are
+ * never freed one by one, reset rewinds to the first chunk in O(1)
+ * and destroy hands every chunk back. Not thread safe.
+ **********************************************************/
+
+#define ARENA_CHUNK_HEADER_SIZE ALIGN_UP_CONST(sizeof(dam_arena_chunk_t), ALIGNMENT)
+
+static inline void arena_enter_chunk(dam_arena_t* arena, dam_arena_chunk_t* chunk) {
+    arena->current = chunk;
+    arena->cursor = (char*)chunk + ARENA_CHUNK_HEADER_SIZE;
+    arena->end = (char*)chunk + chunk->size;
+}
+
+static inline void* arena_bump(dam_arena_t* arena, size_t size, size_t alignment) {
+    if (!arena->current) return NULL;
+
+    char* ptr = (char*)align_up((uintptr_t)arena->cursor, alignment);
+    if (ptr > arena->end || size > (size_t)(arena->end - ptr)) return NULL;
+
+    arena->cursor = ptr + size;
+    return ptr;
+}
+
+// Moves on to the next chunk kept from before the last reset, or links a new one after current.
+static void* arena_alloc_slow(dam_arena_t* arena, size_t size, size_t alignment) {
+    dam_arena_chunk_t* prev = arena->current;
+    dam_arena_chunk_t* next = prev ? prev->next : arena->chunks;
+
+    if (next) {
+        arena_enter_chunk(arena, next);
+        void* ptr = arena_bump(arena, size, alignment);
+        if (ptr) return ptr;
+    }
+
+    size_t needed = ARENA_CHUNK_HEADER_SIZE + size + (alignment - ALIGNMENT);
+    if (needed < size) return NULL;
+    size_t chunk_size = needed > arena->chunk_size ? needed : arena->chunk_size;
+
+    dam_arena_chunk_t* chunk = dam_malloc(chunk_size);
+    if (!chunk) {
+        DAM_LOG_ERROR("[ARENA] Failed to allocate chunk of %zu bytes", chunk_size);
+        return NULL;
+    }
+
+    // Goes in front of next, so chunks kept from before the reset stay in line for reuse.
+    chunk->size = chunk_size;
+    chunk->next = next;
+    if (prev) prev->next = chunk;
+    else arena->chunks = chunk;
+
+    DAM_LOG("[ARENA] New chunk %p of %zu bytes", (void*)chunk, chunk_size);
+
+    arena_enter_chunk(arena, chunk);
+    return arena_bump(arena, size, alignment);
+}
+
+/*********************
+ * Public API        *
+ *********************/
+
+// chunk_size 0 picks DAM_ARENA_CHUNK_SIZE. Returns NULL on failure.
+dam_arena_t* dam_arena_create(size_t chunk_size) {
+    dam_arena_t* arena = dam_malloc(sizeof(dam_arena_t));
+    if (!arena) return NULL;
+
+    if (!chunk_size) chunk_size = DAM_ARENA_CHUNK_SIZE;
+    if (chunk_size < ARENA_CHUNK_HEADER_SIZE + DAM_SMALL_MAX) chunk_size = ARENA_CHUNK_HEADER_SIZE + DAM_SMALL_MAX;
+
+    arena->chunks = NULL;
+    arena->current = NULL;
+    arena->cursor = NULL;
+    arena->end = NULL;
+    arena->chunk_size = chunk_size;
+
+    DAM_LOG("[ARENA] Created arena %p with %zu byte chunks", (void*)arena, chunk_size);
+    return arena;
+}
+
+void* dam_arena_alloc(dam_arena_t* arena, size_t size) {
+    return dam_arena_alloc_aligned(arena, size, ALIGNMENT);
+}
+
+// alignment must be a power of two, smaller ones are raised to ALIGNMENT.
+void* dam_arena_alloc_aligned(dam_arena_t* arena, size_t size, size_t alignment) {
+    if (!arena || size == 0) return NULL;
+
+    if (alignment & (alignment - 1)) {
+        DAM_LOG_ERROR("[ARENA] Alignment %zu is not a power of two", alignment);
+        return NULL;
+    }
+    if (alignment < ALIGNMENT) alignment = ALIGNMENT;
+
+    void* ptr = arena_bump(arena, size, alignment);
+    if (ptr) return ptr;
+
+    return arena_alloc_slow(arena, size, alignment);
+}
+
+// Invalidates everything allocated so far, the chunks are kept and bumped through again.
+void dam_arena_reset(dam_arena_t* arena) {
+    if (!arena) return;
+
+    arena->current = NULL;
+    arena->cursor = NULL;
+    arena->end = NULL;
+}
+
+void dam_arena_destroy(dam_arena_t* arena) {
+    if (!arena) return;
+
+    dam_arena_chunk_t* chunk = arena->chunks;
+    while (chunk) {
+        dam_arena_chunk_t* next = chunk->next;
+        dam_free(chunk);
+        chunk = next;
+    }
+
+    DAM_LOG("[ARENA] Destroyed arena %p", (void*)arena);
+    dam_free(arena);
+}
@@ -1,3 +1,4 @@
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -12,6 +13,7 @@
  * dam_pool_list           ← linked list (ALL pools)
  * ├─ pool_header_t        ← DAM_POOL_SMALL
  * ├─ pool_header_t        ← DAM_POOL_GENERAL
+ * ├─ pool_header_t        ← DAM_POOL_SPAN
  * └─ pool_header_t        ← DAM_POOL_DIRECT
  *
  * Used for:
@@ -22,6 +24,8 @@
 pool_header_t* dam_pool_list = NULL;
 int initialized = 0;
 
+static size_t dam_allocation_size(void* ptr, pool_header_t* pool);
+
 // Returns 0 on success, 1 on failure.
 int dam_init() {
     if (initialized) return 0;
@@ -31,10 +35,15 @@ int dam_init() {
     DAM_LOG("[INIT] Initializing multi-threading and thread local cache...");
     dam_thread_init();
 
+    DAM_LOG("[INIT] Selecting copy and zero kernels...");
+    dam_memory_init();
+
     DAM_LOG("[INIT] Initializing size class allocator...");
     dam_small_init();
     DAM_LOG("[INIT] Initializing growing pool allocator...");
     dam_general_init();
+    DAM_LOG("[INIT] Initializing page span allocator...");
+    dam_span_init();
     DAM_LOG("[INIT] Initializing direct mmap() allocator...");
     dam_direct_init();
 
@@ -44,6 +53,38 @@ int dam_init() {
     return 0;
 }
 
+/*
+ * Creates and prefaults memory ahead of time so steady state allocations never hit the kernel.
+ * target is a small class index (DAM_RESERVE_CLASS) or one of DAM_RESERVE_GENERAL, DAM_RESERVE_SPAN
+ * and DAM_RESERVE_DIRECT. For the direct layer `bytes` is the size of one cached mapping, call it once
+ * per mapping wanted. flags are dam_reserve_flags_t. Returns 0 on success, 1 on failure.
+ */
+int dam_reserve(int target, size_t bytes, unsigned flags) {
+    if (!initialized) dam_init();
+
+    uint8_t result;
+    switch (target) {
+        case DAM_RESERVE_GENERAL:
+            result = dam_general_reserve(bytes, flags);
+            break;
+        case DAM_RESERVE_SPAN:
+            result = dam_span_reserve(bytes, flags);
+            break;
+        case DAM_RESERVE_DIRECT:
+            result = dam_direct_reserve(bytes, flags);
+            break;
+        default:
+            if (target < 0 || target >= DAM_SIZE_CLASS_COUNT) {
+                DAM_LOG_ERROR("[RESERVE] Unknown reservation target %d", target);
+                return 1;
+            }
+            result = dam_small_reserve((uint8_t)target, bytes, flags);
+            break;
+    }
+
+    return result ? 0 : 1;
+}
+
 
 /**********************************************************
 * DAM allocator (core)
@@ -57,6 +98,7 @@ void* dam_malloc(size_t size) {
     if (size == 0) return NULL;
     if (size <= DAM_SMALL_MAX) return dam_small_malloc(size, NULL);
     if (size <= DAM_GENERAL_MAX) return dam_general_malloc(size, NULL);
+    if (size <= DAM_SPAN_MAX) return dam_span_malloc(size, NULL);
     return dam_direct_malloc(size, NULL);
 }
 
@@ -75,6 +117,8 @@ void* dam_realloc(void* ptr, size_t size) {
         return NULL;
     }
 
+    if (pool->heap) return dam_heap_realloc(pool->heap, ptr, size);
+
     switch (pool->type) {
         case DAM_LAYER_SMALL: {
             size_class_header_t* size_class_header = get_size_class_header(ptr);
@@ -84,8 +128,11 @@ void* dam_realloc(void* ptr, size_t size) {
             block_header_t* block_header = get_block_header(ptr);
             return dam_general_realloc(ptr, size, block_header, NULL);
         }
+        case DAM_LAYER_SPAN: {
+            return dam_span_realloc(ptr, size, pool, NULL);
+        }
         case DAM_LAYER_DIRECT: {
-            block_header_t* direct_header = get_direct_header(ptr);
+            block_header_t* direct_header = get_direct_header(pool);
             return dam_direct_realloc(ptr, size, direct_header, NULL);
         }
         default:
@@ -98,13 +145,22 @@ void dam_free(void* ptr) {
     if (!ptr)
         return;
 
+    if (!dam_try_free(ptr)) DAM_LOG_ERROR("[FREE] Pointer does not belong to DAM pool: %p", ptr);
+}
+
+// dam_free() for callers that expect foreign pointers, returns 0 and leaves ptr alone when DAM does not own it.
+uint8_t dam_try_free(void* ptr) {
     pool_header_t* pool = dam_pool_from_ptr(ptr);
+    if (!pool) return 0;
 
-    if (!pool) {
-        DAM_LOG_ERROR("[FREE] Pointer does not belong to DAM pool: %p", ptr);
-        return;
+    if (pool->heap) {
+        dam_heap_free(pool->heap, ptr);
+        return 1;
     }
 
+    // Small frees stay in the thread cache, everything else may be handed to the reclaimer.
+    if (pool->type != DAM_LAYER_SMALL && dam_deferred_free_push(ptr)) return 1;
+
     DAM_LOG("[FREE] Pool type to be freed: %d", pool->type);
     switch (pool->type) {
         case DAM_LAYER_SMALL: {
@@ -117,6 +173,10 @@ void dam_free(void* ptr) {
             dam_general_free(ptr, pool, block_header);
             break;
         }
+        case DAM_LAYER_SPAN: {
+            dam_span_free(ptr, pool);
+            break;
+        }
         case DAM_LAYER_DIRECT: {
             dam_direct_free(ptr);
             break;
@@ -125,16 +185,436 @@ void dam_free(void* ptr) {
             DAM_LOG_ERROR("Unknown pool type for ptr %p", ptr);
             break;
     }
+    return 1;
+}
+
+/*
+ * Frees without a pool lookup, size must be the size the pointer was allocated or last reallocated with,
+ * or its usable size. Aligned allocations may sit in a bigger layer than their size, free them with dam_free().
+ * Heap allocations are not routed by size either, free them with dam_heap_free() or dam_free().
+ */
+void dam_free_sized(void* ptr, size_t size) {
+    if (!ptr)
+        return;
+
+#if DAM_SIZED_FREE_CHECK
+    pool_header_t* pool = dam_pool_from_ptr(ptr);
+    if (!pool || pool->type != dam_layer_for_size(size) || size > dam_allocation_size(ptr, pool)) {
+        DAM_LOG_ERROR("[FREE] Size %zu does not match the allocation at %p", size, ptr);
+        dam_free(ptr);
+        return;
+    }
+#endif
+
+    dam_layer_type_t layer = dam_layer_for_size(size);
+    if (layer != DAM_LAYER_SMALL && dam_deferred_free_push(ptr)) return;
+
+    switch (layer) {
+        case DAM_LAYER_SMALL: {
+            dam_small_free(ptr, get_size_class_header(ptr));
+            break;
+        }
+        case DAM_LAYER_GENERAL: {
+            block_header_t* block_header = get_block_header(ptr);
+            dam_general_free(ptr, block_header->pool_ptr, block_header);
+            break;
+        }
+        case DAM_LAYER_SPAN: {
+            dam_span_free(ptr, &span_chunk_from_ptr(ptr)->pool);
+            break;
+        }
+        case DAM_LAYER_DIRECT: {
+            dam_direct_free(ptr);
+            break;
+        }
+        default:
+            dam_free(ptr);
+            break;
+    }
+}
+
+/*
+ * Small allocation straight from size class class_index, a block of DAM_SMALL_MIN << class_index bytes.
+ * Meant for callers that know the class at compile time, no size is mapped and no pool is looked up.
+ */
+void* dam_class_malloc(unsigned class_index) {
+
+    if (!initialized) dam_init();
+
+    if (class_index >= DAM_SIZE_CLASS_COUNT) {
+        DAM_LOG_ERROR("[ALLOC] Size class %u out of range", class_index);
+        return NULL;
+    }
+
+    return dam_small_class_malloc((uint8_t)class_index);
+}
+
+// Frees a block of class class_index, from dam_class_malloc() or an untraced small dam_malloc() of that class.
+void dam_class_free(void* ptr, unsigned class_index) {
+    if (!ptr)
+        return;
+
+#if DAM_SIZED_FREE_CHECK
+    pool_header_t* pool = dam_pool_from_ptr(ptr);
+    if (!pool || pool->type != DAM_LAYER_SMALL || get_size_class_header(ptr)->size_class_index != class_index) {
+        DAM_LOG_ERROR("[FREE] Size class %u does not match the allocation at %p", class_index, ptr);
+        dam_free(ptr);
+        return;
+    }
+#endif
+
+    dam_small_class_free(ptr, get_size_class_header(ptr), (uint8_t)class_index);
+}
+
+// Allocates count blocks of the same size, returns how many were allocated into out.
+size_t dam_malloc_batch(size_t size, size_t count, void** out) {
+
+    if (!initialized) dam_init();
+
+    if (size == 0 || !out) return 0;
+    if (size <= DAM_SMALL_MAX) return dam_small_malloc_batch(size, count, out);
+    if (size <= DAM_GENERAL_MAX) return dam_general_malloc_batch(size, count, out);
+    if (size <= DAM_SPAN_MAX) return dam_span_malloc_batch(size, count, out);
+    return dam_direct_malloc_batch(size, count, out);
+}
+
+/*
+ * Frees pointers of any layer. Pointers are sorted per layer in groups of DAM_FREE_BATCH_GROUP,
+ * consecutive pointers from the same pool skip the pool lookup.
+ */
+void dam_free_batch(void** ptrs, size_t count) {
+    if (!ptrs) return;
+
+    pool_header_t* pool = NULL;
+
+    for (size_t group = 0; group < count; group += DAM_FREE_BATCH_GROUP) {
+        void* small[DAM_FREE_BATCH_GROUP];
+        void* general[DAM_FREE_BATCH_GROUP];
+        void* span[DAM_FREE_BATCH_GROUP];
+        void* direct[DAM_FREE_BATCH_GROUP];
+        pool_header_t* general_pools[DAM_FREE_BATCH_GROUP];
+        pool_header_t* span_pools[DAM_FREE_BATCH_GROUP];
+        size_t small_count = 0, general_count = 0, span_count = 0, direct_count = 0;
+
+        size_t end = count - group < DAM_FREE_BATCH_GROUP ? count : group + DAM_FREE_BATCH_GROUP;
+        for (size_t i = group; i < end; i++) {
+            void* ptr = ptrs[i];
+            if (!ptr) continue;
+
+            if (!pool || !dam_pool_contains(pool, ptr)) pool = dam_pool_from_ptr(ptr);
+
+            if (!pool) {
+                DAM_LOG_ERROR("[FREE] Pointer does not belong to DAM pool: %p", ptr);
+                continue;
+            }
+
+            if (pool->heap) {
+                dam_heap_free(pool->heap, ptr);
+                continue;
+            }
+
+            switch (pool->type) {
+                case DAM_LAYER_SMALL:
+                    small[small_count++] = ptr;
+                    break;
+                case DAM_LAYER_GENERAL:
+                    general_pools[general_count] = pool;
+                    general[general_count++] = ptr;
+                    break;
+                case DAM_LAYER_SPAN:
+                    span_pools[span_count] = pool;
+                    span[span_count++] = ptr;
+                    break;
+                case DAM_LAYER_DIRECT:
+                    direct[direct_count++] = ptr;
+                    pool = NULL; // Its header is released by the free
+                    break;
+                default:
+                    DAM_LOG_ERROR("Unknown pool type for ptr %p", ptr);
+                    break;
+            }
+        }
+
+        if (small_count) dam_small_free_batch(small, small_count);
+        if (general_count) dam_general_free_batch(general, general_pools, general_count);
+        if (span_count) dam_span_free_batch(span, span_pools, span_count);
+        if (direct_count) dam_direct_free_batch(direct, direct_count);
+
+        pool = NULL; // Empty span chunks may have been released
+    }
+}
+
+/*
+ * Zeroes the first size bytes of a fresh allocation, skipping what the layer knows was never written.
+ * pool is only looked at for the general, span and direct layers.
+ */
+static void dam_zero_allocation(void* ptr, size_t size, pool_header_t* pool) {
+    switch (pool ? pool->type : DAM_LAYER_SMALL) {
+        case DAM_LAYER_GENERAL: {
+            // Only the free list links were written into a block from past the zero mark.
+            if (get_block_header(ptr)->is_zero) size = size < FREE_BLOCK_HEADER_SIZE ? size : FREE_BLOCK_HEADER_SIZE;
+            break;
+        }
+        case DAM_LAYER_SPAN: {
+            if (get_span_entry(ptr, (span_chunk_t*)pool)->is_zero) return;
+            break;
+        }
+        case DAM_LAYER_DIRECT: {
+            if (get_direct_header(pool)->is_zero) return;
+            break;
+        }
+        default:
+            break;
+    }
+
+    dam_memzero(ptr, size);
 }
 
 void* dam_calloc(size_t nmemb, size_t size) {
-    size_t total = nmemb * size;
+    size_t total;
+    if (__builtin_mul_overflow(nmemb, size, &total)) {
+        DAM_LOG_ERROR("[ALLOC] calloc size overflows: %zu * %zu", nmemb, size);
+        return NULL;
+    }
+
     void* ptr = dam_malloc(total);
     if (!ptr) return NULL;
-    if (total <= DAM_GENERAL_MAX) memset(ptr, 0, total);
+
+    if (total <= DAM_SMALL_MAX) memset(ptr, 0, total);
+    else if (total <= DAM_GENERAL_MAX) dam_zero_allocation(ptr, total, get_block_header(ptr)->pool_ptr);
+    else if (total <= DAM_SPAN_MAX) dam_zero_allocation(ptr, total, &span_chunk_from_ptr(ptr)->pool);
+    else dam_zero_allocation(ptr, total, dam_pool_from_ptr(ptr));
+
     return ptr;
 }
 
+/**********************************************************
+* DAM allocator (core)
+*
+* Extended allocation suite
+***********************************************************/
+
+/*
+ * Bytes the caller may use at ptr, a pure read. Small blocks report their whole class, the other layers
+ * the size they record, which later reallocs preserve. dam_malloc_at_least() hands out the slack.
+ */
+size_t dam_usable_size(void* ptr) {
+    if (!ptr) return 0;
+
+    pool_header_t* pool = dam_pool_from_ptr(ptr);
+
+    if (!pool) {
+        DAM_LOG_ERROR("[USABLE] Pointer does not belong to DAM: %p", ptr);
+        return 0;
+    }
+
+    switch (pool->type) {
+        case DAM_LAYER_SMALL:
+            return dam_small_usable_size(ptr, get_size_class_header(ptr));
+        case DAM_LAYER_GENERAL:
+            return dam_general_usable_size(ptr, get_block_header(ptr));
+        case DAM_LAYER_SPAN:
+            return dam_span_usable_size(ptr, pool);
+        case DAM_LAYER_DIRECT:
+            return dam_direct_usable_size(ptr, pool);
+        default:
+            DAM_LOG_ERROR("[USABLE] Unknown pool type for ptr %p", ptr);
+            return 0;
+    }
+}
+
+/*
+ * dam_malloc() that hands the whole capacity of the block to the caller and reports it, recorded under
+ * the lock of the owning layer. Only direct allocations need a pool lookup for it.
+ */
+void* dam_malloc_at_least(size_t size, size_t* actual) {
+    void* ptr = dam_malloc(size);
+
+    if (!actual) return ptr;
+
+    if (!ptr) *actual = 0;
+    else if (size <= DAM_SMALL_MAX) *actual = dam_small_usable_size(ptr, get_size_class_header(ptr));
+    else if (size <= DAM_GENERAL_MAX) *actual = dam_general_commit_usable(ptr, get_block_header(ptr));
+    else if (size <= DAM_SPAN_MAX) *actual = dam_span_commit_usable(ptr, &span_chunk_from_ptr(ptr)->pool);
+    else *actual = dam_direct_commit_usable(ptr, dam_pool_from_ptr(ptr));
+
+    return ptr;
+}
+
+void* dam_aligned_alloc(size_t alignment, size_t size) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        DAM_LOG_ERROR("[ALLOC] Alignment %zu is not a power of two", alignment);
+        return NULL;
+    }
+
+    return dam_mallocx(size, DAM_MALLOCX_ALIGN(alignment));
+}
+
+// Returns 0 on success, EINVAL for a bad alignment and ENOMEM when out of memory.
+int dam_posix_memalign(void** memptr, size_t alignment, size_t size) {
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) return EINVAL;
+
+    if (size == 0) {
+        *memptr = NULL;
+        return 0;
+    }
+
+    void* ptr = dam_mallocx(size, DAM_MALLOCX_ALIGN(alignment));
+    if (!ptr) return ENOMEM;
+
+    *memptr = ptr;
+    return 0;
+}
+
+void* dam_memalign(size_t alignment, size_t size) {
+    return dam_aligned_alloc(alignment, size);
+}
+
+// Usable size of an untraced allocation, used to find the bytes a dam_reallocx() has to zero.
+static size_t dam_allocation_size(void* ptr, pool_header_t* pool) {
+    switch (pool->type) {
+        case DAM_LAYER_SMALL:
+            return dam_small_usable_size(ptr, get_size_class_header(ptr));
+        case DAM_LAYER_GENERAL:
+            return get_block_header(ptr)->user_size;
+        case DAM_LAYER_SPAN:
+            return get_span_entry(ptr, (span_chunk_t*)pool)->user_size;
+        case DAM_LAYER_DIRECT:
+            return get_direct_header(pool)->size;
+        default:
+            return 0;
+    }
+}
+
+/*
+ * Faults in the pages under [ptr, ptr + size). Span and direct allocations own their pages, small and general
+ * blocks share pages with their neighbours, so only the whole pages inside them are populated.
+ */
+static void dam_populate(void* ptr, size_t size, pool_header_t* pool) {
+    uintptr_t page_mask = PAGE_SIZE - 1;
+    uintptr_t start = (uintptr_t)ptr, end = (uintptr_t)ptr + size;
+
+    if (pool->type == DAM_LAYER_SPAN || pool->type == DAM_LAYER_DIRECT) {
+        start &= ~page_mask;
+        end = (end + page_mask) & ~page_mask;
+    } else {
+        start = (start + page_mask) & ~page_mask;
+        end &= ~page_mask;
+    }
+
+    if (end > start) dam_prefault((void*)start, end - start, DAM_RESERVE_POPULATE);
+}
+
+void* dam_mallocx(size_t size, int flags) {
+
+    if (!initialized) dam_init();
+
+    if (size == 0) return NULL;
+
+    size_t alignment = DAM_MALLOCX_ALIGNMENT(flags);
+    void* ptr;
+
+    // Over-aligned small blocks carry alignment - ALIGNMENT bytes of slack, page alignments go to span and direct.
+    size_t slack = alignment > ALIGNMENT ? alignment - ALIGNMENT : 0;
+    size_t padded;
+
+    if (__builtin_add_overflow(size, slack, &padded)) {
+        DAM_LOG_ERROR("[ALLOC] Size %zu with alignment %zu overflows", size, alignment);
+        return NULL;
+    }
+
+    if (padded <= DAM_SMALL_MAX) {
+        ptr = flags & DAM_MALLOCX_NO_TCACHE ? dam_small_malloc_from_central(padded, NULL) : dam_small_malloc(padded, NULL);
+        if (ptr && slack) ptr = dam_small_align_block(ptr, alignment);
+    } else if (size <= DAM_GENERAL_MAX && alignment < PAGE_SIZE) {
+        ptr = slack ? dam_general_malloc_aligned(size, alignment) : dam_general_malloc(size, NULL);
+    } else if (alignment <= DAM_SPAN_MAX && size <= DAM_SPAN_MAX) {
+        ptr = dam_span_mallocx(size, flags);
+    } else {
+        ptr = dam_direct_mallocx(size, flags);
+    }
+
+    if (!ptr) return NULL;
+
+    // Zero the whole usable size so a later zeroing dam_reallocx() only has to clear past it.
+    if (flags & DAM_MALLOCX_ZERO) {
+        pool_header_t* pool = dam_pool_from_ptr(ptr);
+        dam_zero_allocation(ptr, dam_allocation_size(ptr, pool), pool);
+    }
+    else if (flags & DAM_MALLOCX_POPULATE) dam_populate(ptr, size, dam_pool_from_ptr(ptr));
+
+    return ptr;
+}
+
+void* dam_reallocx(void* ptr, size_t size, int flags) {
+    if (!ptr) return dam_mallocx(size, flags);
+
+    if (size == 0) {
+        dam_free(ptr);
+        return NULL;
+    }
+
+    pool_header_t* pool = dam_pool_from_ptr(ptr);
+
+    if (!pool) {
+        DAM_LOG_ERROR("[REALLOC] Pointer does not belong to DAM: %p", ptr);
+        return NULL;
+    }
+
+    size_t old_size = dam_allocation_size(ptr, pool);
+    size_t alignment = DAM_MALLOCX_ALIGNMENT(flags);
+    void* new_ptr;
+
+    if (alignment <= ALIGNMENT) {
+        new_ptr = dam_realloc(ptr, size);
+        if (!new_ptr) return NULL;
+    } else if ((uintptr_t)ptr % alignment == 0 && size <= old_size) {
+        new_ptr = ptr;
+    } else {
+        // The layers only keep page alignment when they move, so over-aligned growth always moves here.
+        new_ptr = dam_mallocx(size, flags & ~DAM_MALLOCX_ZERO);
+        if (!new_ptr) return NULL;
+
+        dam_memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+        dam_free(ptr);
+    }
+
+    if (size > old_size) {
+        if (flags & DAM_MALLOCX_ZERO) dam_memzero((char*)new_ptr + old_size, size - old_size);
+        else if (flags & DAM_MALLOCX_POPULATE) dam_populate((char*)new_ptr + old_size, size - old_size, dam_pool_from_ptr(new_ptr));
+    }
+
+    return new_ptr;
+}
+
+/*
+ * Returns a copy of the allocation at ptr, or NULL on failure. The first clone of a DAM_MALLOCX_CLONEABLE
+ * direct allocation shares its pages copy-on-write instead, everything else is copied.
+ */
+void* dam_clone(void* ptr) {
+    if (!ptr) return NULL;
+
+    pool_header_t* pool = dam_pool_from_ptr(ptr);
+
+    if (!pool) {
+        DAM_LOG_ERROR("[CLONE] Pointer does not belong to DAM: %p", ptr);
+        return NULL;
+    }
+
+    int flags = 0;
+    if (pool->type == DAM_LAYER_DIRECT && ((direct_header_t*)pool)->fd >= 0) {
+        void* clone = dam_direct_clone(ptr, pool);
+        if (clone) return clone;
+        flags = DAM_MALLOCX_CLONEABLE;
+    }
+
+    size_t size = dam_allocation_size(ptr, pool);
+    void* clone = dam_mallocx(size, flags);
+    if (clone) dam_memcpy(clone, ptr, size);
+
+    return clone;
+}
+
 /**********************************************************
 * DAM allocator (core)
 *
@@ -148,6 +628,7 @@ void* dam_trace_malloc(size_t size, const char* trace) {
     if (size == 0) return NULL;
     if (size <= DAM_SMALL_MAX) return dam_small_malloc(size, trace);
     if (size <= DAM_GENERAL_MAX) return dam_general_malloc(size, trace);
+    if (size <= DAM_SPAN_MAX) return dam_span_malloc(size, trace);
     return dam_direct_malloc(size, trace);
 }
 
@@ -169,15 +650,18 @@ void* dam_trace_realloc(void* ptr, size_t size) {
     char* trace = dam_get_trace(ptr);
     switch (pool->type) {
         case DAM_LAYER_SMALL: {
-            size_class_header_t* size_class_header = get_size_class_header(ptr);
+            size_class_header_t* size_class_header = get_size_class_trace_header(ptr);
             return dam_small_realloc(ptr, size, size_class_header, trace);
         }
         case DAM_LAYER_GENERAL: {
             block_header_t* block_header = get_block_trace_header(ptr);
             return dam_general_realloc(ptr, size, block_header, trace);
         }
+        case DAM_LAYER_SPAN: {
+            return dam_span_realloc(ptr, size, pool, trace);
+        }
         case DAM_LAYER_DIRECT: {
-            block_header_t* direct_header = get_direct_trace_header(ptr);
+            block_header_t* direct_header = get_direct_header(pool);
             return dam_direct_realloc(ptr, size, direct_header, trace);
         }
         default:
@@ -210,18 +694,23 @@ void dam_uaf_free(void* ptr) {
         switch (pool_header->type) {
             case DAM_LAYER_SMALL: {
                 size_class_header_t* size_class_header = get_size_class_header(ptr);
-                memset(ptr, 0, class_to_size(get_size_class_header(ptr)->size_class_index));
+                memset(ptr, 0, dam_small_usable_size(ptr, size_class_header));
                 dam_small_free(ptr, size_class_header);
                 break;
             }
             case DAM_LAYER_GENERAL: {
                 block_header_t* block_header = get_block_trace_header(ptr);
-                memset(ptr, 0, get_block_header(ptr)->size);
+                dam_memzero(ptr, get_block_header(ptr)->size);
                 dam_general_free(ptr, pool_header, block_header);
                 break;
             }
+            case DAM_LAYER_SPAN: {
+                dam_memzero(ptr, get_span_entry(ptr, (span_chunk_t*)pool_header)->user_size);
+                dam_span_free(ptr, pool_header);
+                break;
+            }
             case DAM_LAYER_DIRECT: {
-                memset(ptr, 0, get_block_header(ptr)->size);
+                dam_memzero(ptr, get_direct_header(pool_header)->size);
                 dam_direct_free(ptr);
                 break;
             }
@@ -238,6 +727,7 @@ void dam_uaf_free(void* ptr) {
 void dam_snapshot(dam_snapshot_t* snapshot) {
     dam_snapshot_small(snapshot);
     dam_snapshot_general(snapshot);
+    dam_snapshot_span(snapshot);
     dam_snapshot_direct(snapshot);
 }
 
@@ -245,6 +735,7 @@ dam_layer_type_t dam_layer_for_size(size_t size) {
     if (size == 0) return DAM_LAYER_ERROR;
     if (size <= DAM_SMALL_MAX) return DAM_LAYER_SMALL;
     if (size <= DAM_GENERAL_MAX) return DAM_LAYER_GENERAL;
+    if (size <= DAM_SPAN_MAX) return DAM_LAYER_SPAN;
     return DAM_LAYER_DIRECT;
 }
 
@@ -260,6 +751,9 @@ dam_layer_type_t dam_layer_for_size(size_t size) {
  * size_t count = dam_general_pool_snapshots(buffer, pool_count);
  */
 size_t dam_fragmentation(dam_pool_fragmentation_t* snapshot_buffer, size_t capacity) {
+    dam_general_lock();
+    dam_pool_list_read_lock();
+
     pool_header_t* current = dam_pool_list;
     size_t count = 0;
     while (current) {
@@ -270,17 +764,21 @@ size_t dam_fragmentation(dam_pool_fragmentation_t* snapshot_buffer, size_t capac
         current = current->next;
     }
 
+    dam_pool_list_unlock();
+    dam_general_unlock();
     return count;
 }
 
 // This function is kinda useless for the public API as it only counts general pools.
 size_t dam_pool_count() {
+    dam_pool_list_read_lock();
     pool_header_t* current = dam_pool_list;
     size_t count = 0;
     while (current) {
         if (current->type == DAM_LAYER_GENERAL) count++;
         current = current->next;
     }
+    dam_pool_list_unlock();
 
     return count;
 }
@@ -324,9 +822,15 @@ uint8_t dam_validate_ptr(void* ptr, uint8_t quarantine, uint8_t is_traced) {
                 dam_general_unlock();
                 break;
 
+            case DAM_LAYER_SPAN:
+                dam_span_lock();
+                result = dam_validate_span_ptr(ptr, pool_header);
+                dam_span_unlock();
+                break;
+
             case DAM_LAYER_DIRECT:
                 dam_direct_lock();
-                block_header_t* direct_header = get_direct_header(ptr);
+                block_header_t* direct_header = get_direct_header(pool_header);
                 result = dam_validate_direct_ptr(ptr, direct_header);
                 dam_direct_unlock();
                 break;
@@ -355,9 +859,15 @@ uint8_t dam_validate_ptr(void* ptr, uint8_t quarantine, uint8_t is_traced) {
                 dam_general_unlock();
                 break;
 
+            case DAM_LAYER_SPAN:
+                dam_span_lock();
+                result = dam_validate_span_ptr(ptr, pool_header);
+                dam_span_unlock();
+                break;
+
             case DAM_LAYER_DIRECT:
                 dam_direct_lock();
-                block_header_t* direct_header = get_direct_trace_header(ptr);
+                block_header_t* direct_header = get_direct_header(pool_header);
                 result = dam_validate_direct_ptr(ptr, direct_header);
                 dam_direct_unlock();
                 break;
@@ -0,0 +1,234 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include "dam/dam.h"
+#include "dam/dam_config.h"
+#include "dam/dam_log.h"
+#include "dam/internal/dam_internal.h"
+
+/**********************************************************
+ * Deferred free
+ *
+ * owning thread                 reclaimer thread
+ * dam_free()                    every DAM_DEFERRED_FREE_INTERVAL_MS
+ * └─ ring->slots[tail++]  ───►  └─ slots[head..tail) → dam_free_batch()
+ *
+ * Each ring has one producer, its owning thread, and one consumer at a
+ * time, whoever holds reclaim_lock. A full ring frees synchronously.
+ * The reclaimer unregisters pools, so dam_pool_list is read under its lock.
+ **********************************************************/
+
+#define RING_MASK (DAM_DEFERRED_FREE_RING_SIZE - 1)
+
+_Static_assert((DAM_DEFERRED_FREE_RING_SIZE & RING_MASK) == 0, "DAM_DEFERRED_FREE_RING_SIZE must be a power of two");
+
+typedef struct deferred_ring {
+    _Alignas(64) _Atomic size_t tail;
+    _Alignas(64) _Atomic size_t head;
+    _Atomic uint8_t retired; // Owner disabled deferral or exited, the reclaimer unmaps the ring once empty
+    struct deferred_ring* next;
+    void* slots[DAM_DEFERRED_FREE_RING_SIZE];
+} deferred_ring_t;
+
+static pthread_mutex_t reclaim_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t reclaim_cond;
+static pthread_t reclaimer;
+static uint8_t reclaimer_running = 0;
+
+static deferred_ring_t* rings = NULL; // Guarded by reclaim_lock
+
+static __thread deferred_ring_t* deferred_ring = NULL;
+
+static pthread_key_t deferred_ring_key;
+static pthread_once_t deferred_once = PTHREAD_ONCE_INIT;
+
+/*********************
+ * Reclaim           *
+ *********************/
+
+// Frees everything queued in ring, caller holds reclaim_lock. Returns the number of frees.
+static size_t drain_ring(deferred_ring_t* ring) {
+    void* batch[DAM_FREE_BATCH_GROUP];
+    size_t drained = 0;
+
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    while (head != tail) {
+        size_t count = 0;
+        while (head != tail && count < DAM_FREE_BATCH_GROUP) {
+            batch[count++] = ring->slots[head & RING_MASK];
+            head++;
+        }
+
+        // The slots are copied out, the owner may refill them while the batch is freed.
+        atomic_store_explicit(&ring->head, head, memory_order_release);
+        dam_free_batch(batch, count);
+        drained += count;
+
+        if (head == tail) tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    }
+
+    return drained;
+}
+
+// Drains every ring and unmaps retired ones that are empty, caller holds reclaim_lock.
+static size_t drain_all(void) {
+    size_t drained = 0;
+    deferred_ring_t** link = &rings;
+
+    while (*link) {
+        deferred_ring_t* ring = *link;
+
+        // Read retired first, a ring retired after this point is drained on the next pass.
+        uint8_t retired = atomic_load_explicit(&ring->retired, memory_order_acquire);
+        drained += drain_ring(ring);
+
+        if (retired) {
+            *link = ring->next;
+            munmap(ring, sizeof(deferred_ring_t));
+            continue;
+        }
+
+        link = &ring->next;
+    }
+
+    return drained;
+}
+
+static void* reclaimer_main(void* arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&reclaim_lock);
+    for (;;) {
+        size_t drained = drain_all();
+        if (drained) DAM_LOG("[DEFERRED] Reclaimer freed %zu allocations", drained);
+
+        struct timespec deadline;
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_nsec += DAM_DEFERRED_FREE_INTERVAL_MS * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+
+        pthread_cond_timedwait(&reclaim_cond, &reclaim_lock, &deadline);
+    }
+
+    return NULL;
+}
+
+/*********************
+ * Ring lifetime     *
+ *********************/
+
+static void retire_ring(void* ring_ptr) {
+    deferred_ring_t* ring = ring_ptr;
+    if (!ring) return;
+
+    atomic_store_explicit(&ring->retired, 1, memory_order_release);
+    pthread_cond_signal(&reclaim_cond);
+}
+
+static void make_deferred_ring_key(void) {
+    pthread_key_create(&deferred_ring_key, retire_ring);
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&reclaim_cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+/*
+ * Turns deferred free on for the calling thread. From then on dam_free() and dam_free_sized() of
+ * general, span and direct allocations only queue the pointer, a background reclaimer frees it.
+ * Small frees already stay thread local and are never deferred. Returns 0 on success, 1 on failure.
+ */
+int dam_deferred_free_enable(void) {
+    if (deferred_ring) return 0;
+
+    pthread_once(&deferred_once, make_deferred_ring_key);
+
+    deferred_ring_t* ring = mmap(
+        NULL,
+        sizeof(deferred_ring_t),
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,
+        0
+    );
+
+    if (ring == MAP_FAILED) {
+        DAM_LOG_ERROR("[DEFERRED] Failed to allocate deferred free ring");
+        return 1;
+    }
+
+    pthread_mutex_lock(&reclaim_lock);
+
+    if (!reclaimer_running) {
+        if (pthread_create(&reclaimer, NULL, reclaimer_main, NULL) != 0) {
+            pthread_mutex_unlock(&reclaim_lock);
+            munmap(ring, sizeof(deferred_ring_t));
+            DAM_LOG_ERROR("[DEFERRED] Failed to start reclaimer thread");
+            return 1;
+        }
+        pthread_detach(reclaimer);
+        reclaimer_running = 1;
+    }
+
+    ring->next = rings;
+    rings = ring;
+
+    pthread_mutex_unlock(&reclaim_lock);
+
+    pthread_setspecific(deferred_ring_key, ring);
+    deferred_ring = ring;
+
+    DAM_LOG("[DEFERRED] Enabled for thread %lu", pthread_self());
+    return 0;
+}
+
+// Turns deferred free off for the calling thread, frees still queued are reclaimed in the background.
+void dam_deferred_free_disable(void) {
+    if (!deferred_ring) return;
+
+    retire_ring(deferred_ring);
+    pthread_setspecific(deferred_ring_key, NULL);
+    deferred_ring = NULL;
+
+    DAM_LOG("[DEFERRED] Disabled for thread %lu", pthread_self());
+}
+
+// Frees everything queued by any thread before the call returns.
+void dam_deferred_free_flush(void) {
+    pthread_mutex_lock(&reclaim_lock);
+    drain_all();
+    pthread_mutex_unlock(&reclaim_lock);
+}
+
+/*
+ * Queues ptr on the calling thread's ring. Returns 1 when queued, 0 when the caller must free
+ * synchronously: deferral is off for this thread or the ring is full.
+ */
+uint8_t dam_deferred_free_push(void* ptr) {
+    deferred_ring_t* ring = deferred_ring;
+    if (!ring) return 0;
+
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t used = tail - atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    if (used == DAM_DEFERRED_FREE_RING_SIZE) {
+        DAM_LOG("[DEFERRED] Ring full, freeing %p synchronously", ptr);
+        return 0;
+    }
+
+    ring->slots[tail & RING_MASK] = ptr;
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+    // Wake the reclaimer once per fill instead of on every push.
+    if (used + 1 == DAM_DEFERRED_FREE_RING_SIZE / 2) pthread_cond_signal(&reclaim_cond);
+
+    return 1;
+}
@@ -1,85 +1,528 @@
+#define _GNU_SOURCE // mremap(), memfd_create()
+
+#include <fcntl.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <unistd.h>
 
 #include "dam/dam.h"
 #include "dam/dam_config.h"
 #include "dam/dam_log.h"
 #include "dam/internal/dam_internal.h"
 
+/**********************************************************
+ * Direct allocator
+ *
+ * dam_pool_list           ← linked list (global)
+ * └─ pool_header_t        ← DAM_POOL_DIRECT (one per mapping)
+ *     └─ memory           ← page aligned payload, no inline metadata
+ *
+ * header slabs            ← mmap()'d arrays of direct_header_t
+ * └─ free list            ← linked list through pool.next
+ *
+ * Pool and block headers live out of line in a header slab, so payloads
+ * start on a page boundary and a power-of-two request maps exactly its
+ * own size. Traced allocations keep their trace in the first TRACE_SIZE
+ * bytes of the mapping.
+ *
+ * direct_cache[]          ← array (per page count bucket)
+ * └─ direct_cache_entry_t ← linked list (freed mappings, newest first)
+ *
+ * Freed mappings are parked in the cache instead of being unmapped, so
+ * the next fitting request skips mmap() and the first touch page faults.
+ * Bucket i holds mappings of [2^i, 2^(i+1)) pages.
+ * The cache is bounded in bytes and entries expire after a maximum age.
+ *
+ * memfd                   ← DAM_MALLOCX_CLONEABLE / DAM_DIRECT_MEMFD
+ * ├─ original             ← MAP_SHARED until its first clone
+ * └─ clone                ← MAP_PRIVATE, original remapped MAP_PRIVATE too
+ *
+ * Cloneable mappings are never cached. A clone costs page tables, the
+ * pages are copied by the kernel when either side writes them.
+ **********************************************************/
+static direct_cache_entry_t* direct_cache[DAM_DIRECT_CACHE_BUCKETS];
+static direct_cache_entry_t* direct_cache_tail[DAM_DIRECT_CACHE_BUCKETS];
+static size_t direct_cache_count = 0;
+static size_t direct_cache_bytes = 0;
+
+static direct_header_t* direct_header_free_list = NULL;
+
+static size_t direct_cache_max_bytes = DAM_DIRECT_CACHE_MAX_BYTES;
+static size_t direct_cache_max_entry_size = DAM_DIRECT_CACHE_MAX_ENTRY_SIZE;
+static uint64_t direct_cache_max_age_ms = DAM_DIRECT_CACHE_MAX_AGE_MS;
+
 void  dam_direct_init(void) {}
 
-void* dam_direct_malloc_internal(size_t size, const char* trace) {
-    size_t total = align_up(sizeof(pool_header_t) +sizeof(block_header_t) + size, PAGE_SIZE);
+// Caller must hold the direct lock.
+static direct_header_t* direct_header_alloc(void) {
+    if (!direct_header_free_list) {
+        direct_header_t* slab = mmap(
+            NULL,
+            DAM_DIRECT_HEADER_SLAB_SIZE,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS,
+            -1,
+            0
+        );
+
+        if (slab == MAP_FAILED) {
+            DAM_LOG_ERROR("mmap failed for direct header slab");
+            return NULL;
+        }
+
+        for (size_t i = 0; i < DAM_DIRECT_HEADER_SLAB_SIZE / sizeof(direct_header_t); i++) {
+            slab[i].pool.next = (pool_header_t*)direct_header_free_list;
+            direct_header_free_list = &slab[i];
+        }
+    }
+
+    direct_header_t* header = direct_header_free_list;
+    direct_header_free_list = (direct_header_t*)header->pool.next;
+    memset(header, 0, sizeof(direct_header_t));
+    header->fd = -1;
+    return header;
+}
+
+// Caller must hold the direct lock.
+static void direct_header_release(direct_header_t* header) {
+    header->block.magic = FREED_MAGIC;
+    header->block.is_free = 1;
+    header->pool.memory = NULL;
+    header->pool.size = 0;
+    header->pool.next = (pool_header_t*)direct_header_free_list;
+    direct_header_free_list = header;
+}
+
+// offset + size rounded up to granularity, 0 when that does not fit a size_t.
+static size_t direct_total_for(size_t offset, size_t size, size_t granularity) {
+    size_t total;
+    if (__builtin_add_overflow(offset, size, &total) || total > SIZE_MAX - (granularity - 1)) return 0;
+    return align_up(total, granularity);
+}
+
+static size_t direct_cache_bucket(size_t size) {
+    size_t pages = size / PAGE_SIZE;
+    size_t bucket = 63 - __builtin_clzll(pages);
+    return bucket < DAM_DIRECT_CACHE_BUCKETS ? bucket : DAM_DIRECT_CACHE_BUCKETS - 1;
+}
+
+static void direct_cache_unlink(size_t bucket, direct_cache_entry_t* entry) {
+    if (entry->prev) entry->prev->next = entry->next;
+    else direct_cache[bucket] = entry->next;
+
+    if (entry->next) entry->next->prev = entry->prev;
+    else direct_cache_tail[bucket] = entry->prev;
+
+    direct_cache_count--;
+    direct_cache_bytes -= entry->size;
+}
+
+static void direct_cache_evict(size_t bucket, direct_cache_entry_t* entry) {
+    direct_cache_unlink(bucket, entry);
+    DAM_LOG("[CACHE] Evicting mapping %p of %zu bytes", (void*)entry, entry->size);
+    munmap(entry, entry->size);
+}
+
+// Tails are the oldest entry of every bucket, walk towards the head until entries are young enough.
+// Pinned (reserved) entries never expire.
+static void direct_cache_expire(uint64_t now) {
+    for (size_t i = 0; i < DAM_DIRECT_CACHE_BUCKETS; i++) {
+        direct_cache_entry_t* entry = direct_cache_tail[i];
+        while (entry && now - entry->cached_at > direct_cache_max_age_ms) {
+            direct_cache_entry_t* prev = entry->prev;
+            if (!entry->is_pinned) direct_cache_evict(i, entry);
+            entry = prev;
+        }
+    }
+}
+
+static direct_cache_entry_t* direct_cache_oldest_unpinned(size_t bucket) {
+    direct_cache_entry_t* entry = direct_cache_tail[bucket];
+    while (entry && entry->is_pinned) entry = entry->prev;
+    return entry;
+}
+
+// Evicts the oldest unpinned entries until `incoming` more bytes fit in the byte limit.
+static void direct_cache_make_room(size_t incoming) {
+    while (direct_cache_bytes + incoming > direct_cache_max_bytes) {
+        size_t oldest = DAM_DIRECT_CACHE_BUCKETS;
+        direct_cache_entry_t* victim = NULL;
+        for (size_t i = 0; i < DAM_DIRECT_CACHE_BUCKETS; i++) {
+            direct_cache_entry_t* entry = direct_cache_oldest_unpinned(i);
+            if (entry && (!victim || entry->cached_at < victim->cached_at)) {
+                oldest = i;
+                victim = entry;
+            }
+        }
+        if (!victim) return;
+        direct_cache_evict(oldest, victim);
+    }
+}
+
+/*
+ * Takes a cached mapping of at least `size` bytes and describes it in pool_header (memory, size and backing),
+ * or returns NULL. The mapping may be up to DAM_DIRECT_CACHE_SLACK_PERCENTAGE bigger than asked.
+ * Caller must hold the direct lock.
+ */
+void* direct_cache_take(size_t size, pool_header_t* pool_header) {
+    if (!direct_cache_count) return NULL;
+
+    direct_cache_expire(dam_now_ms());
+
+    size_t max_size = size + size * DAM_DIRECT_CACHE_SLACK_PERCENTAGE / 100;
+    size_t bucket = direct_cache_bucket(size);
+
+    for (size_t i = bucket; i < DAM_DIRECT_CACHE_BUCKETS && i <= bucket + 1; i++) {
+        direct_cache_entry_t* entry = direct_cache[i];
+        while (entry) {
+            if (entry->size >= size && entry->size <= max_size) {
+                direct_cache_unlink(i, entry);
+                pool_header->memory = entry;
+                pool_header->size = entry->size;
+                pool_header->is_huge = entry->is_huge;
+                pool_header->is_pinned = entry->is_pinned;
+                DAM_LOG("[CACHE] Reusing mapping %p of %zu bytes for %zu bytes", (void*)entry, entry->size, size);
+                return entry;
+            }
+            entry = entry->next;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Parks the mapping of pool_header in the cache. Returns 0 when the mapping does not qualify,
+ * the caller is then still responsible for unmapping it. Pinned mappings always qualify.
+ * Caller must hold the direct lock.
+ */
+uint8_t direct_cache_put(const pool_header_t* pool_header) {
+    size_t size = pool_header->size;
+    if (!pool_header->is_pinned && (size > direct_cache_max_entry_size || size > direct_cache_max_bytes)) return 0;
+
+    uint64_t now = dam_now_ms();
+    direct_cache_expire(now);
+    if (!pool_header->is_pinned) direct_cache_make_room(size);
+
+    size_t bucket = direct_cache_bucket(size);
+    direct_cache_entry_t* entry = pool_header->memory;
+    entry->size = size;
+    entry->cached_at = now;
+    entry->is_huge = pool_header->is_huge;
+    entry->is_pinned = pool_header->is_pinned;
+    entry->prev = NULL;
+    entry->next = direct_cache[bucket];
+
+    if (entry->next) entry->next->prev = entry;
+    else direct_cache_tail[bucket] = entry;
+    direct_cache[bucket] = entry;
+
+    direct_cache_count++;
+    direct_cache_bytes += size;
+
+    DAM_LOG("[CACHE] Cached mapping %p of %zu bytes (bucket %zu)", (void*)entry, size, bucket);
+    return 1;
+}
+
+// Bytes usable at ptr, the size the mapping records and later reallocs preserve.
+size_t dam_direct_usable_size(void* ptr, pool_header_t* pool_header) {
+    (void)ptr;
+    return get_direct_header(pool_header)->size;
+}
+
+// Records the capacity of a fresh direct mapping from ptr on as its size, so later reallocs preserve it.
+size_t dam_direct_commit_usable(void* ptr, pool_header_t* pool_header) {
+    dam_direct_lock();
+
+    size_t usable_size = pool_header->size - (size_t)((char*)ptr - (char*)pool_header->memory);
+    get_direct_header(pool_header)->size = usable_size;
+
+    dam_direct_unlock();
+    return usable_size;
+}
+
+/*
+ * Maps `bytes` ahead of time and parks the mapping in the cache as a pinned entry, which is
+ * exempt from age and byte limit eviction and stays pinned across reuse. Only a flush releases it.
+ * A failed prefault keeps the mapping like the other layers keep their pools, but returns 0.
+ */
+uint8_t dam_direct_reserve(size_t bytes, unsigned flags) {
+    dam_direct_lock();
 
-    void* memory = mmap(
-        NULL,
-        total,
-        PROT_READ | PROT_WRITE,
-        MAP_PRIVATE | MAP_ANONYMOUS,
-        -1,
-        0
-    );
+    pool_header_t pool_header = {0};
+    pool_header.size = align_up(bytes, PAGE_SIZE);
+    pool_header.memory = dam_map_pool(pool_header.size, &pool_header.is_huge);
+    pool_header.is_pinned = 1;
 
-    if (memory == MAP_FAILED)
+    if (!pool_header.memory) {
+        dam_direct_unlock();
+        return 0;
+    }
+
+    uint8_t result = dam_prefault(pool_header.memory, pool_header.size, flags);
+    direct_cache_put(&pool_header);
+
+    dam_direct_unlock();
+    return result;
+}
+
+/*
+ * Sets the cache limits at runtime. A max_bytes of 0 disables the cache.
+ * Entries that no longer fit the new limits are released immediately.
+ */
+void dam_direct_cache_configure(size_t max_bytes, size_t max_entry_size, uint64_t max_age_ms) {
+    dam_direct_lock();
+    direct_cache_max_bytes = max_bytes;
+    direct_cache_max_entry_size = max_entry_size;
+    direct_cache_max_age_ms = max_age_ms;
+
+    for (size_t i = 0; i < DAM_DIRECT_CACHE_BUCKETS; i++) {
+        direct_cache_entry_t* entry = direct_cache[i];
+        while (entry) {
+            direct_cache_entry_t* next = entry->next;
+            if (entry->size > max_entry_size && !entry->is_pinned) direct_cache_evict(i, entry);
+            entry = next;
+        }
+    }
+    direct_cache_expire(dam_now_ms());
+    direct_cache_make_room(0);
+    dam_direct_unlock();
+}
+
+// Returns every cached mapping to the OS.
+void dam_direct_cache_flush(void) {
+    dam_direct_lock();
+    for (size_t i = 0; i < DAM_DIRECT_CACHE_BUCKETS; i++) {
+        while (direct_cache[i]) direct_cache_evict(i, direct_cache[i]);
+    }
+    dam_direct_unlock();
+}
+
+// Maps a new memfd of total bytes MAP_SHARED and hands its fd back. Returns NULL on failure.
+static void* direct_map_memfd(size_t total, size_t alignment, int* fd) {
+    int memfd = memfd_create("dam_direct", MFD_CLOEXEC);
+    if (memfd < 0) {
+        DAM_LOG_ERROR("[DIRECT] memfd_create failed for %zu bytes", total);
+        return NULL;
+    }
+
+    if (ftruncate(memfd, (off_t)total) != 0) {
+        DAM_LOG_ERROR("[DIRECT] Failed to size memfd to %zu bytes", total);
+        close(memfd);
         return NULL;
+    }
+
+    // Over-aligned requests reserve an aligned range first and map the memfd over it.
+    void* hint = alignment > PAGE_SIZE ? dam_map_aligned(total, alignment) : NULL;
+    if (alignment > PAGE_SIZE && !hint) {
+        close(memfd);
+        return NULL;
+    }
+
+    void* memory = mmap(hint, total, PROT_READ | PROT_WRITE, MAP_SHARED | (hint ? MAP_FIXED : 0), memfd, 0);
+    if (memory == MAP_FAILED) {
+        DAM_LOG_ERROR("[DIRECT] mmap failed for memfd of %zu bytes", total);
+        if (hint) munmap(hint, total);
+        close(memfd);
+        return NULL;
+    }
+
+    *fd = memfd;
+    return memory;
+}
+
+/*
+ * flags are dam_mallocx() flags, only DAM_MALLOCX_ALIGN, DAM_MALLOCX_HUGE and DAM_MALLOCX_CLONEABLE are looked at.
+ * Cloneable mappings ignore DAM_MALLOCX_HUGE.
+ * Alignments above PAGE_SIZE bypass the cache and over-map to find an aligned address.
+ */
+void* dam_direct_malloc_internal(size_t size, const char* trace, int flags) {
+    size_t offset = trace != NULL ? TRACE_SIZE : 0;
+    size_t total = direct_total_for(offset, size, PAGE_SIZE);
+    size_t alignment = DAM_MALLOCX_ALIGNMENT(flags);
+
+    // Aligned and huge mappings over-map by up to the bigger of both.
+    size_t padding = alignment > HUGE_PAGE_SIZE ? alignment : HUGE_PAGE_SIZE;
+    if (!total || total > SIZE_MAX - padding) {
+        DAM_LOG_ERROR("[DIRECT] Size %zu overflows when rounded to pages and aligned", size);
+        return NULL;
+    }
+    uint8_t huge = (flags & DAM_MALLOCX_HUGE) != 0;
+    uint8_t cloneable = DAM_DIRECT_MEMFD || (flags & DAM_MALLOCX_CLONEABLE);
 
-    pool_header_t* pool_header = memory;
+    direct_header_t* header = direct_header_alloc();
+    if (!header) return NULL;
+
+    pool_header_t* pool_header = &header->pool;
+    void* memory = NULL;
+
+    if (cloneable) {
+        memory = direct_map_memfd(total, alignment, &header->fd);
+        if (!memory) {
+            direct_header_release(header);
+            return NULL;
+        }
+    } else if (alignment <= PAGE_SIZE) {
+        memory = direct_cache_take(total, pool_header);
+    }
+    uint8_t is_zero = cloneable || memory == NULL; // Only fresh mappings are known to be zero
+
+    if (!memory && (huge || dam_huge_page_policy_has(DAM_HUGE_PAGE_HUGETLB)) && alignment <= HUGE_PAGE_SIZE) {
+        size_t huge_total = align_up(total, HUGE_PAGE_SIZE);
+        memory = dam_map_hugetlb(huge_total);
+        if (memory) {
+            total = huge_total;
+            pool_header->is_huge = DAM_HUGE_BACKING_HUGETLB;
+        }
+    }
+
+    if (!memory && (huge || alignment > PAGE_SIZE)) {
+        memory = dam_map_aligned(total, alignment > HUGE_PAGE_SIZE || !huge ? alignment : HUGE_PAGE_SIZE);
+        if (memory) pool_header->is_huge = huge ? dam_madvise_huge(memory, total) : dam_advise_huge(memory, total);
+    }
+
+    if (!memory) {
+        memory = dam_map_pool(total, &pool_header->is_huge);
+
+        if (!memory) {
+            direct_header_release(header);
+            return NULL;
+        }
+    }
+
+    if (pool_header->memory != memory) {
+        pool_header->memory = memory;
+        pool_header->size = total;
+    }
     pool_header->type = DAM_LAYER_DIRECT;
-    pool_header->size = total;
-    pool_header->memory = memory;
+    pool_header->block_list = &header->block;
 
     dam_register_pool(pool_header);
 
-    block_header_t* block_header = (block_header_t*)(pool_header + 1);
+    block_header_t* block_header = &header->block;
     block_header->size = size;
     block_header->magic = BLOCK_MAGIC;
+    block_header->pool_ptr = pool_header;
+    block_header->is_zero = is_zero;
 
     if (trace != NULL) {
         block_header->is_traced = 1;
-        char* trace_ptr = (char*)block_header + BLOCK_HEADER_SIZE;
+        char* trace_ptr = memory;
         strncpy(trace_ptr, trace, TRACE_SIZE - 1);
         trace_ptr[TRACE_SIZE - 1] = '\0';
 
-        return (char*)block_header + BLOCK_HEADER_SIZE + TRACE_SIZE;
+        return (char*)memory + TRACE_SIZE;
     }
 
-    return (char*)block_header + BLOCK_HEADER_SIZE;
+    return memory;
 }
 
 void  dam_direct_free_internal(void* ptr) {
     if (!ptr) return;
 
     pool_header_t* pool_header = dam_pool_from_ptr(ptr);
+    direct_header_t* header = (direct_header_t*)pool_header;
 
     dam_unregister_pool(pool_header);
-    munmap(pool_header, pool_header->size);
+    if (header->fd >= 0) {
+        munmap(pool_header->memory, pool_header->size);
+        close(header->fd);
+    } else if (!direct_cache_put(pool_header)) {
+        munmap(pool_header->memory, pool_header->size);
+    }
+    direct_header_release(header);
 }
 
 void* dam_direct_malloc(size_t size, const char* trace) {
     dam_direct_lock();
-    void* ptr = dam_direct_malloc_internal(size, trace);
+    void* ptr = dam_direct_malloc_internal(size, trace, 0);
+    dam_direct_unlock();
+
+    return ptr;
+}
+
+void* dam_direct_mallocx(size_t size, int flags) {
+    dam_direct_lock();
+    void* ptr = dam_direct_malloc_internal(size, NULL, flags);
     dam_direct_unlock();
 
     return ptr;
 }
 
+size_t dam_direct_malloc_batch(size_t size, size_t count, void** out) {
+    size_t allocated = 0;
+
+    dam_direct_lock();
+    while (allocated < count) {
+        void* ptr = dam_direct_malloc_internal(size, NULL, 0);
+        if (!ptr) break;
+        out[allocated++] = ptr;
+    }
+    dam_direct_unlock();
+
+    return allocated;
+}
+
+void dam_direct_free_batch(void** ptrs, size_t count) {
+    dam_direct_lock();
+    for (size_t i = 0; i < count; i++) {
+        dam_direct_free_internal(ptrs[i]);
+    }
+    dam_direct_unlock();
+}
+
 void  dam_direct_free(void* ptr) {
     dam_direct_lock();
     dam_direct_free_internal(ptr);
     dam_direct_unlock();
 }
 
-void* dam_direct_realloc(void* ptr, size_t size, const block_header_t* direct_header, const char* trace) {
+/*
+ * Resizes the mapping behind a direct allocation with mremap(), so the kernel moves page tables instead of
+ * the payload being copied. Returns NULL if the kernel refuses, or for a snapshot whose memfd other clones map.
+ * Caller must hold the direct lock.
+ */
+static void* direct_remap(void* ptr, size_t size, pool_header_t* pool_header, size_t new_total) {
+    size_t offset = (char*)ptr - (char*)pool_header->memory;
+    direct_header_t* header = (direct_header_t*)pool_header;
+
+    if (header->is_snapshot) return NULL;
+
+    // A memfd mapping must stay within the file, so the file grows before the mapping and shrinks after it.
+    if (header->fd >= 0 && new_total > pool_header->size && ftruncate(header->fd, (off_t)new_total) != 0) {
+        DAM_LOG_ERROR("[REALLOC] Failed to grow memfd of %p to %zu bytes", ptr, new_total);
+        return NULL;
+    }
+
+    void* memory = mremap(pool_header->memory, pool_header->size, new_total, new_total > pool_header->size ? MREMAP_MAYMOVE : 0);
+
+    if (memory == MAP_FAILED) {
+        DAM_LOG_ERROR("[REALLOC] mremap failed for %p (%zu -> %zu bytes)", ptr, pool_header->size, new_total);
+        return NULL;
+    }
+
+    if (header->fd >= 0 && new_total < pool_header->size) ftruncate(header->fd, (off_t)new_total);
+
+    pool_header->memory = memory;
+    pool_header->size = new_total;
+    pool_header->block_list->size = size;
+    if (header->fd < 0 && pool_header->is_huge != DAM_HUGE_BACKING_HUGETLB) pool_header->is_huge = dam_advise_huge(memory, new_total);
+
+    DAM_LOG("[REALLOC] Remapped %p to %p (%zu bytes)", ptr, (char*)memory + offset, new_total);
+    return (char*)memory + offset;
+}
+
+void* dam_direct_realloc(void* ptr, size_t size, block_header_t* direct_header, const char* trace) {
     size_t old_size = direct_header->size;
 
     // Case 1 Shrink to lower layer
     void* new_ptr;
-    if (size <= DAM_GENERAL_MAX) {
-        new_ptr = dam_malloc(size);
+    if (size <= DAM_SPAN_MAX) {
+        new_ptr = dam_trace_malloc(size, trace);
         if (new_ptr) {
-            memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+            dam_memcpy(new_ptr, ptr, old_size < size ? old_size : size);
             dam_direct_free(ptr);
         }
         return new_ptr;
@@ -87,11 +530,35 @@ void* dam_direct_realloc(void* ptr, size_t size, const block_header_t* direct_he
 
     dam_direct_lock();
 
-    // Case 2/3 stay inside direct
-    if (size *  100 <= old_size * DAM_DIRECT_SHRINK_PERCENTAGE || size > direct_header->size) {
-        new_ptr = dam_direct_malloc_internal(size, trace);
+    pool_header_t* pool_header = direct_header->pool_ptr;
+    size_t granularity = pool_header->is_huge == DAM_HUGE_BACKING_HUGETLB ? HUGE_PAGE_SIZE : PAGE_SIZE;
+    size_t new_total = direct_total_for((char*)ptr - (char*)pool_header->memory, size, granularity);
+
+    if (!new_total) {
+        DAM_LOG_ERROR("[REALLOC] Size %zu overflows when rounded to pages", size);
+        dam_direct_unlock();
+        return NULL;
+    }
+
+    // Case 2 Grow into the page rounding slack that is already mapped
+    if (size > old_size && new_total <= pool_header->size) {
+        direct_header->size = size;
+        dam_direct_unlock();
+        return ptr;
+    }
+
+    // Case 3/4 Grow or shrink the mapping itself
+    if (size * 100 <= old_size * DAM_DIRECT_SHRINK_PERCENTAGE || size > old_size) {
+        new_ptr = direct_remap(ptr, size, pool_header, new_total);
+        if (new_ptr) {
+            dam_direct_unlock();
+            return new_ptr;
+        }
+
+        // Remap refused, fall back to copying into a fresh mapping.
+        new_ptr = dam_direct_malloc_internal(size, trace, ((direct_header_t*)pool_header)->fd >= 0 ? DAM_MALLOCX_CLONEABLE : 0);
         if (new_ptr) {
-            memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+            dam_memcpy(new_ptr, ptr, old_size < size ? old_size : size);
             dam_direct_free_internal(ptr);
         }
         dam_direct_unlock();
@@ -102,16 +569,89 @@ void* dam_direct_realloc(void* ptr, size_t size, const block_header_t* direct_he
     return ptr;
 }
 
+/*
+ * Maps the memfd of a cloneable allocation a second time, MAP_PRIVATE, and moves a private mapping of it
+ * over the original, so both see today's bytes and the kernel copies pages on write. Only the first clone
+ * shares pages, afterwards either side may hold private pages the memfd does not have.
+ * Returns NULL when the allocation cannot be cloned this way. No thread may write to ptr meanwhile.
+ */
+void* dam_direct_clone(void* ptr, pool_header_t* pool_header) {
+    direct_header_t* header = (direct_header_t*)pool_header;
+    size_t size = pool_header->size;
+
+    dam_direct_lock();
+
+    if (header->fd < 0 || header->is_snapshot) {
+        dam_direct_unlock();
+        return NULL;
+    }
+
+    direct_header_t* clone = direct_header_alloc();
+    if (!clone) {
+        dam_direct_unlock();
+        return NULL;
+    }
+
+    void* memory = MAP_FAILED;
+    void* frozen = MAP_FAILED;
+    clone->fd = fcntl(header->fd, F_DUPFD_CLOEXEC, 0);
+
+    if (clone->fd >= 0) memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, clone->fd, 0);
+    if (memory != MAP_FAILED) frozen = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, header->fd, 0);
+
+    // mremap() swaps the original's shared mapping out in one step, it is left alone on failure.
+    if (frozen != MAP_FAILED && mremap(frozen, size, size, MREMAP_MAYMOVE | MREMAP_FIXED, pool_header->memory) == MAP_FAILED) {
+        munmap(frozen, size);
+        frozen = MAP_FAILED;
+    }
+
+    if (frozen == MAP_FAILED) {
+        DAM_LOG_ERROR("[DIRECT] Failed to clone %p (%zu bytes)", ptr, size);
+        if (memory != MAP_FAILED) munmap(memory, size);
+        if (clone->fd >= 0) close(clone->fd);
+        direct_header_release(clone);
+        dam_direct_unlock();
+        return NULL;
+    }
+
+    header->is_snapshot = 1;
+    clone->is_snapshot = 1;
+
+    pool_header_t* clone_pool = &clone->pool;
+    clone_pool->memory = memory;
+    clone_pool->size = size;
+    clone_pool->type = DAM_LAYER_DIRECT;
+    clone_pool->block_list = &clone->block;
+
+    block_header_t* block_header = &clone->block;
+    block_header->size = header->block.size;
+    block_header->magic = BLOCK_MAGIC;
+    block_header->pool_ptr = clone_pool;
+    block_header->is_traced = header->block.is_traced;
+
+    dam_register_pool(clone_pool);
+
+    dam_direct_unlock();
+
+    DAM_LOG("[DIRECT] Cloned %p to %p (%zu bytes)", pool_header->memory, memory, size);
+    return (char*)memory + ((char*)ptr - (char*)pool_header->memory);
+}
+
 void dam_snapshot_direct(dam_snapshot_t* snapshot) {
-    pool_header_t* current = dam_pool_list;
     dam_direct_lock();
+    dam_pool_list_read_lock();
+    pool_header_t* current = dam_pool_list;
     while (current) {
         if (current->type == DAM_LAYER_DIRECT) {
             snapshot->direct_allocations++;
             snapshot->direct_bytes_used += current->size;
+            if (current->is_huge) snapshot->huge_page_bytes += current->size;
         }
         current = current->next;
     }
+    dam_pool_list_unlock();
+    snapshot->direct_cached_mappings += direct_cache_count;
+    snapshot->direct_cached_bytes += direct_cache_bytes;
     dam_direct_unlock();
 }
 
@@ -133,14 +673,6 @@ uint8_t dam_validate_direct_ptr(void* ptr, const block_header_t* direct_header)
     return 1;
 }
 
-inline pool_header_t* direct_pool_from_ptr(void* ptr) {
-    return (pool_header_t*)((char*)ptr - sizeof(block_header_t) - sizeof(pool_header_t));
-}
-
-inline block_header_t* get_direct_header(void* ptr) {
-    return (block_header_t*)((char*)ptr - sizeof(block_header_t));
-}
-
-inline block_header_t* get_direct_trace_header(void* ptr) {
-    return (block_header_t*)((char*)ptr - sizeof(block_header_t) - TRACE_SIZE);
+inline block_header_t* get_direct_header(pool_header_t* pool_header) {
+    return pool_header->block_list;
 }
@@ -22,12 +22,27 @@
  **********************************************************/
 
 void  dam_general_init() {
-    if (!create_general_pool(INITIAL_POOL_SIZE)) {
+    if (!create_general_pool(NULL, INITIAL_POOL_SIZE)) {
         DAM_LOG_ERROR("Failed to create initial pool");
     }
 }
 
-void* dam_general_malloc_internal(size_t size, const char* trace) {
+// Moves the zero mark of a general pool past end, everything up to it may have been written.
+static inline void general_mark_dirty(pool_header_t* pool_header, void* end) {
+    if ((char*)end > (char*)pool_header->zero_mark) pool_header->zero_mark = end;
+}
+
+// A heap allocates from its own pools only, the global heap (NULL) from every pool that has no heap.
+static inline pool_header_t* first_pool_of(dam_heap_t* heap) {
+    return heap ? heap->pools : dam_pool_list;
+}
+
+static inline pool_header_t* next_pool_of(dam_heap_t* heap, pool_header_t* pool_header) {
+    return heap ? pool_header->heap_next : pool_header->next;
+}
+
+// alignment of 0 means ALIGNMENT, bigger alignments split the front of the found block off.
+static void* general_malloc_from(dam_heap_t* heap, size_t size, const char* trace, size_t alignment) {
     const size_t aligned_size = align_up(size, ALIGNMENT);
     size_t actual_size = aligned_size + sizeof(uint32_t);
     actual_size = align_up(actual_size, ALIGNMENT);
@@ -35,18 +50,19 @@ void* dam_general_malloc_internal(size_t size, const char* trace) {
     pool_header_t* found_pool = NULL;
     block_header_t* found_block = NULL;
 
-    found_block = find_free_block_in_pools(&found_pool, actual_size);
+    found_block = find_free_block_in_pools(heap, &found_pool, actual_size, alignment);
 
     if (!found_block) {
-        const size_t min_pool_size = POOL_GENERAL_SIZE + BLOCK_HEADER_SIZE +  actual_size + MIN_BLOCK_SIZE;
-        pool_header_t* new_pool = create_general_pool(min_pool_size);
+        size_t min_pool_size = POOL_GENERAL_SIZE + BLOCK_HEADER_SIZE +  actual_size + MIN_BLOCK_SIZE;
+        if (alignment > ALIGNMENT) min_pool_size += BLOCK_HEADER_SIZE + MIN_BLOCK_SIZE + alignment;
+        pool_header_t* new_pool = create_general_pool(heap, min_pool_size);
 
         if (!new_pool) {
             DAM_LOG_ERROR("[ALLOC] FAILED: Could not create new pool");
             return NULL;
         }
 
-        found_block = find_free_block_in_pools(&found_pool, actual_size);
+        found_block = find_free_block_in_pools(heap, &found_pool, actual_size, alignment);
 
         if (!found_block) {
             DAM_LOG_ERROR("[ALLOC] FAILED: Still no space after creating pool!");
@@ -56,10 +72,13 @@ void* dam_general_malloc_internal(size_t size, const char* trace) {
 
     DAM_LOG("[ALLOC] Found free block: size=%zu at %p", found_block->size, (void*)found_block);
 
+    found_block = split_block_aligned(found_block, alignment);
     found_block->is_free = 0;
     found_block->magic = BLOCK_MAGIC;
+    found_block->is_zero = (char*)found_block + BLOCK_HEADER_SIZE >= (char*)found_block->pool_ptr->zero_mark;
     split_block_if_possible(found_block, actual_size);
     found_block->user_size = size;
+    general_mark_dirty(found_block->pool_ptr, (char*)found_block + BLOCK_HEADER_SIZE + found_block->size);
 
     void* ptr;
 
@@ -84,6 +103,15 @@ void* dam_general_malloc_internal(size_t size, const char* trace) {
     return ptr;
 }
 
+void* dam_general_malloc_internal(size_t size, const char* trace, size_t alignment) {
+    return general_malloc_from(NULL, size, trace, alignment);
+}
+
+// Allocates from the heap's own pools, the caller holds the heap lock. Any size fits, pools grow to match.
+void* dam_general_heap_malloc(dam_heap_t* heap, size_t size) {
+    return general_malloc_from(heap, size, NULL, 0);
+}
+
 void dam_general_free_internal(void* ptr, pool_header_t* pool_header, block_header_t* block_header) {
     // Double free checks
     if (block_header->magic == FREED_MAGIC) {
@@ -146,33 +174,38 @@ inline free_block_header_t* get_free_block_header(block_header_t* block_header)
     return (free_block_header_t*)((char*)block_header + BLOCK_HEADER_SIZE);
 }
 
-block_header_t* find_free_block_in_pools(pool_header_t** found_pool, size_t actual_size) {
-    pool_header_t* current_pool = dam_pool_list;
+block_header_t* find_free_block_in_pools(dam_heap_t* heap, pool_header_t** found_pool, size_t actual_size, size_t alignment) {
+    block_header_t* block = NULL;
+
+    dam_pool_list_read_lock();
+    pool_header_t* current_pool = first_pool_of(heap);
     while (current_pool) {
         if (current_pool->read_only ) {
             DAM_LOG_VALID("[ALLOC] Pool %p skipped due to quarantine.", current_pool);
-            current_pool = current_pool->next;
+            current_pool = next_pool_of(heap, current_pool);
             continue;
         }
-        if (current_pool->type == DAM_LAYER_GENERAL && current_pool->has_free) {
-            block_header_t* block = search_in_free_list(current_pool, actual_size);
+        if (current_pool->type == DAM_LAYER_GENERAL && current_pool->heap == heap && current_pool->has_free) {
+            block = search_in_free_list(current_pool, actual_size, alignment);
             if (block) {
                 *found_pool = current_pool;
-                return block;
+                break;
             }
         }
-        current_pool = current_pool->next;
+        current_pool = next_pool_of(heap, current_pool);
     }
-    return NULL;
+    dam_pool_list_unlock();
+    return block;
 }
 
 
-block_header_t* search_in_free_list(pool_header_t* pool_header, size_t actual_size) {
+block_header_t* search_in_free_list(pool_header_t* pool_header, size_t actual_size, size_t alignment) {
     block_header_t* current = pool_header->free_list;
 
     while (current) {
         free_block_header_t* free_block_header = get_free_block_header(current);
-        if (current->size >= actual_size) {
+        size_t front = aligned_payload_offset(current, alignment) - BLOCK_HEADER_SIZE;
+        if (current->size >= front + actual_size) {
             remove_from_free_list(pool_header, current);
             return current;
         }
@@ -199,12 +232,42 @@ void remove_from_free_list(pool_header_t* pool_header, block_header_t* block_hea
 
 void* dam_general_malloc(size_t size, const char* trace) {
     dam_general_lock();
-    void* ptr = dam_general_malloc_internal(size, trace);
+    void* ptr = dam_general_malloc_internal(size, trace, 0);
+    dam_general_unlock();
+
+    return ptr;
+}
+
+void* dam_general_malloc_aligned(size_t size, size_t alignment) {
+    dam_general_lock();
+    void* ptr = dam_general_malloc_internal(size, NULL, alignment);
     dam_general_unlock();
 
     return ptr;
 }
 
+size_t dam_general_malloc_batch(size_t size, size_t count, void** out) {
+    size_t allocated = 0;
+
+    dam_general_lock();
+    while (allocated < count) {
+        void* ptr = dam_general_malloc_internal(size, NULL, 0);
+        if (!ptr) break;
+        out[allocated++] = ptr;
+    }
+    dam_general_unlock();
+
+    return allocated;
+}
+
+void dam_general_free_batch(void** ptrs, pool_header_t** pools, size_t count) {
+    dam_general_lock();
+    for (size_t i = 0; i < count; i++) {
+        dam_general_free_internal(ptrs[i], pools[i], get_block_header(ptrs[i]));
+    }
+    dam_general_unlock();
+}
+
 void dam_general_free(void* ptr, pool_header_t* pool_header, block_header_t* block_header) {
     dam_general_lock();
     dam_general_free_internal(ptr, pool_header, block_header);
@@ -220,6 +283,16 @@ void* dam_general_realloc(void* ptr, size_t size, block_header_t* block_header,
         quarantine = 1;
     }
 
+    // Case 1 Shrink to lower layer, so the layer of a block always follows from its size
+    if (size <= DAM_SMALL_MAX) {
+        void* new_ptr = dam_trace_malloc(size, trace);
+        if (new_ptr) {
+            dam_memcpy(new_ptr, ptr, size);
+            dam_general_free(ptr, block_header->pool_ptr, block_header);
+        }
+        return new_ptr;
+    }
+
     dam_general_lock();
 
     if (block_header->magic != BLOCK_MAGIC) {
@@ -227,8 +300,11 @@ void* dam_general_realloc(void* ptr, size_t size, block_header_t* block_header,
         return NULL;
     }
 
-    // Case 1 Shrink in place
-    if (block_header->size >= new_actual_size && !quarantine) {
+    // Past DAM_GENERAL_MAX the block moves up a layer like in case 1, even if it would fit here.
+    uint8_t in_place = !quarantine && size <= DAM_GENERAL_MAX;
+
+    // Case 2 Shrink in place
+    if (block_header->size >= new_actual_size && in_place) {
 
         block_header->user_size = size;
         uint32_t* end_canary = (uint32_t*)((char*)ptr + size);
@@ -240,8 +316,8 @@ void* dam_general_realloc(void* ptr, size_t size, block_header_t* block_header,
         return ptr;
     }
 
-    // Case 2 grow in-place if next block is free
-    if (block_header->next_ptr && block_header->next_ptr->is_free && !quarantine) {
+    // Case 3 grow in-place if next block is free
+    if (block_header->next_ptr && block_header->next_ptr->is_free && in_place) {
         size_t available_space = block_header->size + BLOCK_HEADER_SIZE + block_header->next_ptr->size;
 
         if (available_space >= new_actual_size) {
@@ -262,6 +338,7 @@ void* dam_general_realloc(void* ptr, size_t size, block_header_t* block_header,
             *end_canary = CANARY_VALUE;
 
             split_block_if_possible(block_header, new_actual_size);
+            general_mark_dirty(block_header->pool_ptr, (char*)block_header + BLOCK_HEADER_SIZE + block_header->size);
 
             dam_general_unlock();
 
@@ -269,29 +346,90 @@ void* dam_general_realloc(void* ptr, size_t size, block_header_t* block_header,
         }
     }
 
-    // Case 3 Grow in-place but no next block is not free, so copy and free
+    // Case 4 Grow in-place but no next block is not free, or the block leaves the layer, so copy and free
     dam_general_unlock();
     void* new_ptr = dam_trace_malloc(size, trace); // always traced call, even if trace is NULL.
     if (new_ptr) {
         size_t copy_size = (block_header->user_size < size) ? block_header->user_size : size;
-        memcpy(new_ptr, ptr, copy_size);
+        dam_memcpy(new_ptr, ptr, copy_size);
         dam_free(ptr);
     }
 
     return new_ptr;
 }
 
-static size_t calculate_next_pool_size(size_t min_required) {
+// Bytes usable at ptr, the canary sits right behind them.
+size_t dam_general_usable_size(void* ptr, const block_header_t* block_header) {
+    (void)ptr;
+    return block_header->user_size;
+}
+
+/*
+ * Hands the slack of a fresh global general block to the caller, the canary moves to the end of the block
+ * and later reallocs preserve it. Capped at DAM_GENERAL_MAX so dam_free_sized() still routes to this layer.
+ */
+size_t dam_general_commit_usable(void* ptr, block_header_t* block_header) {
+    dam_general_lock();
+
+    size_t offset = (char*)ptr - ((char*)block_header + BLOCK_HEADER_SIZE);
+    size_t usable_size = block_header->size - offset - sizeof(uint32_t);
+    if (usable_size > DAM_GENERAL_MAX) usable_size = DAM_GENERAL_MAX;
+
+    if (block_header->user_size < usable_size) {
+        block_header->user_size = usable_size;
+        uint32_t* end_canary = dam_get_general_canary(ptr, block_header);
+        *end_canary = CANARY_VALUE;
+    }
+
+    dam_general_unlock();
+    return block_header->user_size;
+}
+
+/*
+ * Makes sure the general pools have at least `bytes` free, creating a pool for the shortfall.
+ * Only that new pool is prefaulted according to flags, existing pools hold other threads' blocks.
+ */
+uint8_t dam_general_reserve(size_t bytes, unsigned flags) {
+    dam_general_lock();
+
+    size_t available = 0;
+    dam_pool_list_read_lock();
+    pool_header_t* current = dam_pool_list;
+    while (current) {
+        if (current->type == DAM_LAYER_GENERAL && !current->read_only && !current->heap) {
+            block_header_t* block = current->free_list;
+            while (block) {
+                available += block->size;
+                block = get_free_block_header(block)->next_ptr;
+            }
+        }
+        current = current->next;
+    }
+    dam_pool_list_unlock();
+
+    uint8_t result = 1;
+    if (available < bytes) {
+        pool_header_t* pool = create_general_pool(NULL, POOL_GENERAL_SIZE + BLOCK_HEADER_SIZE + bytes - available);
+        if (!pool || !dam_prefault(pool->memory, pool->size, flags)) result = 0;
+    }
+
+    dam_general_unlock();
+    return result;
+}
+
+static size_t calculate_next_pool_size(dam_heap_t* heap, size_t min_required) {
     size_t next_size = INITIAL_POOL_SIZE;
 
-    struct pool_header* current = dam_pool_list;
+    dam_pool_list_read_lock();
+    struct pool_header* current = first_pool_of(heap);
 
     while (current) {
-        if (current->size > next_size) {
+        if (current->size > next_size && current->heap == heap) {
             next_size = current->size;
         }
-        current = current->next;
+        current = next_pool_of(heap, current);
     }
+    dam_pool_list_unlock();
 
     next_size *= 2;
 
@@ -302,33 +440,31 @@ static size_t calculate_next_pool_size(size_t min_required) {
     return next_size;
 }
 
-pool_header_t* create_general_pool(size_t min_size) {
+// Pools of a heap count against MAX_POOLS of that heap only.
+pool_header_t* create_general_pool(dam_heap_t* heap, size_t min_size) {
     size_t pool_count = 0;
-    pool_header_t* temp = dam_pool_list;
+    dam_pool_list_read_lock();
+    pool_header_t* temp = first_pool_of(heap);
     while (temp) {
-        pool_count++;
-        temp = temp->next;
+        if (temp->heap == heap) pool_count++;
+        temp = next_pool_of(heap, temp);
     }
+    dam_pool_list_unlock();
 
     if (pool_count >= MAX_POOLS) {
         DAM_LOG_ERROR("[ERROR] Maximum number of pools (%d) reached", MAX_POOLS);
         return NULL;
     }
 
-    size_t pool_size = calculate_next_pool_size(min_size);
+    size_t pool_size = calculate_next_pool_size(heap, min_size);
+    if (dam_huge_page_policy_has(DAM_HUGE_PAGE_ROUND_POOLS)) pool_size = align_up(pool_size, HUGE_PAGE_SIZE);
 
     DAM_LOG("[POOL] Creating pool #%zu of %zu bytes...", pool_count + 1, pool_size);
 
-    void* memory = mmap(
-        NULL,
-        pool_size,
-        PROT_READ | PROT_WRITE,
-        MAP_PRIVATE | MAP_ANONYMOUS,
-        -1,
-        0
-    );
+    uint8_t is_huge;
+    void* memory = dam_map_pool(pool_size, &is_huge);
 
-    if (memory == MAP_FAILED) {
+    if (!memory) {
         DAM_LOG_ERROR("mmap failed for new pool");
         return NULL;
     }
@@ -337,6 +473,7 @@ pool_header_t* create_general_pool(size_t min_size) {
     new_pool->memory = memory;
     new_pool->size = pool_size;
     new_pool->type = DAM_LAYER_GENERAL;
+    new_pool->is_huge = is_huge;
     new_pool->block_list = (block_header_t*)((char*)memory + POOL_GENERAL_SIZE);
     new_pool->free_list = new_pool->block_list;
     new_pool->has_free = 1;
@@ -351,12 +488,18 @@ pool_header_t* create_general_pool(size_t min_size) {
     new_pool->block_list->next_ptr = NULL;
     new_pool->block_list->magic = FREED_MAGIC;
     new_pool->block_list->pool_ptr = new_pool;
+    new_pool->zero_mark = usable_start;
+    new_pool->heap = heap;
 
     free_block_header_t* free_block_header = get_free_block_header(new_pool->block_list);
     free_block_header->next_ptr = NULL;
     free_block_header->prev_ptr = NULL;
 
     dam_register_pool(new_pool);
+    if (heap) {
+        new_pool->heap_next = heap->pools;
+        heap->pools = new_pool;
+    }
 
     DAM_LOG("[POOL] Created at %p with %zu bytes usable", memory, new_pool->free_list->size);
 
@@ -364,8 +507,7 @@ pool_header_t* create_general_pool(size_t min_size) {
 }
 
 block_header_t* find_block_in_pools(size_t actual_size, pool_header_t** found_pool) {
-    if (!dam_pool_list) return NULL;
-
+    dam_pool_list_read_lock();
     pool_header_t* current_pool = dam_pool_list;
     while (current_pool) {
         if (current_pool->read_only == 1) {
@@ -377,7 +519,7 @@ block_header_t* find_block_in_pools(size_t actual_size, pool_header_t** found_po
         while (current_block) {
             if (current_block->is_free && current_block->size >= actual_size) {
                 *found_pool = current_pool;
-
+                dam_pool_list_unlock();
                 return current_block;
             }
             current_block = current_block->next_ptr;
@@ -385,6 +527,7 @@ block_header_t* find_block_in_pools(size_t actual_size, pool_header_t** found_po
         current_pool = current_pool->next;
     }
 
+    dam_pool_list_unlock();
     return NULL;
 }
 
@@ -409,11 +552,54 @@ void split_block_if_possible(block_header_t* block_header, size_t actual_size) {
     }
 }
 
+/*
+ * Distance from a block header to the first payload address aligned to `alignment`.
+ * A non minimal distance always leaves room for a free front block of at least MIN_BLOCK_SIZE.
+ */
+size_t aligned_payload_offset(const block_header_t* block_header, size_t alignment) {
+    uintptr_t payload = (uintptr_t)block_header + BLOCK_HEADER_SIZE;
+    if (alignment <= ALIGNMENT || payload % alignment == 0) return BLOCK_HEADER_SIZE;
+
+    payload = align_up(payload + BLOCK_HEADER_SIZE + MIN_BLOCK_SIZE, alignment);
+    return payload - (uintptr_t)block_header;
+}
+
+/*
+ * Splits the front of a free block (already off the free list) so the payload of the returned block is aligned.
+ * The front stays a free block, the caller still splits the tail with split_block_if_possible().
+ */
+block_header_t* split_block_aligned(block_header_t* block_header, size_t alignment) {
+    size_t offset = aligned_payload_offset(block_header, alignment);
+    if (offset == BLOCK_HEADER_SIZE) return block_header;
+
+    size_t front = offset - BLOCK_HEADER_SIZE;
+    block_header_t* aligned_block = (block_header_t*)((char*)block_header + front);
+
+    aligned_block->size = block_header->size - front;
+    aligned_block->user_size = 0;
+    aligned_block->is_traced = 0;
+    aligned_block->next_ptr = block_header->next_ptr;
+    aligned_block->prev.ptr = block_header;
+    aligned_block->pool_ptr = block_header->pool_ptr;
+
+    if (block_header->next_ptr) block_header->next_ptr->prev.ptr = aligned_block;
+
+    block_header->size = front - BLOCK_HEADER_SIZE;
+    block_header->next_ptr = aligned_block;
+    block_header->is_free = 1;
+    block_header->magic = FREED_MAGIC;
+    add_to_free_list(block_header->pool_ptr, block_header);
+
+    DAM_LOG("[SPLIT] Aligned split: front=%zu, aligned block=%p", block_header->size, (void*)aligned_block);
+    return aligned_block;
+}
+
 block_header_t* coalesce_if_possible(block_header_t* block_header, pool_header_t* pool_header) {
     // Coalesce with previous block if it's free
     if (block_header->prev.ptr && block_header->prev.ptr->is_free && block_header->prev.ptr->magic == FREED_MAGIC) {
         DAM_LOG("[COALESCE] Merging with previous block: %zu + %zu", block_header->prev->size, block_header->size);
         remove_from_free_list(pool_header, block_header->prev.ptr);
+        general_mark_dirty(pool_header, (char*)block_header + BLOCK_HEADER_SIZE + FREE_BLOCK_HEADER_SIZE);
         block_header->prev.ptr->size += BLOCK_HEADER_SIZE + block_header->size;
         block_header->prev.ptr->next_ptr = block_header->next_ptr;
         if (block_header->next_ptr) block_header->next_ptr->prev.ptr = block_header->prev.ptr;
@@ -427,6 +613,7 @@ block_header_t* coalesce_if_possible(block_header_t* block_header, pool_header_t
         if ((void*)block_header->next_ptr >= pool_header->memory && (char*)block_header->next_ptr < (char*)pool_header->memory + pool_header->size) {
             DAM_LOG("[COALESCE] Merging with next block: %zu + %zu", block_header->size, block_header->next->size);
             remove_from_free_list(pool_header, block_header->next_ptr);
+            general_mark_dirty(pool_header, (char*)block_header->next_ptr + BLOCK_HEADER_SIZE + FREE_BLOCK_HEADER_SIZE);
             block_header->size += BLOCK_HEADER_SIZE + block_header->next_ptr->size;
             block_header->next_ptr = block_header->next_ptr->next_ptr;
 
@@ -449,26 +636,28 @@ inline block_header_t* get_block_trace_header(void* ptr) {
 
 
 void dam_snapshot_general(dam_snapshot_t* snapshot) {
-    pool_header_t* current = dam_pool_list;
     dam_general_lock();
+    dam_pool_list_read_lock();
+    pool_header_t* current = dam_pool_list;
 
     while (current) {
         if (current->type == DAM_LAYER_GENERAL) {
             snapshot->pools_bytes_used += current->size;
             snapshot->pools_active++;
+            if (current->is_huge) snapshot->huge_page_bytes += current->size;
             if (current->read_only) snapshot->quarantined_pools++;
         }
         current = current->next;
     }
 
+    dam_pool_list_unlock();
     dam_general_unlock();
 }
 
 // 1.0 - (largest_free_block / total_free_bytes)
 // Get the largest free block by iteration and saving the latest biggest one.
-// While doing that, addition all the bytes of free blocks.
+// While doing that, addition all the bytes of free blocks. Caller holds the general lock.
 void dam_general_fragmentation(pool_header_t* pool, dam_pool_fragmentation_t* snapshot) {
-    dam_general_lock();
     block_header_t* current = pool->block_list;
     while (current) {
         if (current->is_free && current->magic == FREED_MAGIC) {
@@ -478,7 +667,6 @@ void dam_general_fragmentation(pool_header_t* pool, dam_pool_fragmentation_t* sn
         current = current->next_ptr;
     }
     snapshot->fragmentation = (float)snapshot->largest_free / (float)snapshot->free;
-    dam_general_unlock();
 }
 
 void dam_general_pressure(pool_header_t* pool, dam_pool_pressure_t* snapshot) {
@@ -0,0 +1,196 @@
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "dam/dam.h"
+#include "dam/dam_config.h"
+#include "dam/dam_log.h"
+#include "dam/internal/dam_internal.h"
+
+/**********************************************************
+ * Heaps
+ *
+ * dam_heap_t
+ * ├─ size_classes[]       ← array (own class lists, no tcache)
+ * └─ pools                ← linked list through heap_next
+ *     ├─ DAM_LAYER_SMALL
+ *     └─ DAM_LAYER_GENERAL (any size, pools grow to fit)
+ *
+ * Heap pools are registered in dam_pool_list like any other, so
+ * dam_free() and dam_realloc() find their way back here, but global
+ * allocations never search them. One lock per heap.
+ **********************************************************/
+
+static inline uint8_t heap_is_valid(const dam_heap_t* heap) {
+    return heap && heap->magic == HEAP_MAGIC;
+}
+
+static pool_header_t* heap_pool_from_ptr(dam_heap_t* heap, void* ptr) {
+    pool_header_t* pool_header = heap->pools;
+
+    while (pool_header) {
+        if (dam_pool_contains(pool_header, ptr)) return pool_header;
+        pool_header = pool_header->heap_next;
+    }
+    return NULL;
+}
+
+static void* heap_malloc_internal(dam_heap_t* heap, size_t size) {
+    if (size <= DAM_SMALL_MAX) return dam_small_heap_malloc(heap, size);
+    return dam_general_heap_malloc(heap, size);
+}
+
+static void heap_free_internal(dam_heap_t* heap, void* ptr, pool_header_t* pool_header) {
+    if (pool_header->type == DAM_LAYER_SMALL) {
+        dam_small_heap_free(heap, ptr, get_size_class_header(ptr));
+    } else {
+        dam_general_free_internal(ptr, pool_header, get_block_header(ptr));
+    }
+}
+
+// Bytes usable at ptr without moving it.
+static size_t heap_capacity(void* ptr, pool_header_t* pool_header) {
+    if (pool_header->type == DAM_LAYER_SMALL) return dam_small_usable_size(ptr, get_size_class_header(ptr));
+    return get_block_header(ptr)->size - sizeof(uint32_t);
+}
+
+/*********************
+ * Public API        *
+ *********************/
+
+// Returns NULL on failure. Pools are created on first use.
+dam_heap_t* dam_heap_create(void) {
+    dam_heap_t* heap = mmap(
+        NULL,
+        sizeof(dam_heap_t),
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,
+        0
+    );
+
+    if (heap == MAP_FAILED) {
+        DAM_LOG_ERROR("[HEAP] Failed to allocate heap");
+        return NULL;
+    }
+
+    pthread_mutex_init(&heap->lock, NULL);
+    dam_small_heap_init(heap);
+    heap->pools = NULL;
+    heap->magic = HEAP_MAGIC;
+
+    DAM_LOG("[HEAP] Created heap %p", (void*)heap);
+    return heap;
+}
+
+void* dam_heap_malloc(dam_heap_t* heap, size_t size) {
+    if (!heap_is_valid(heap)) {
+        DAM_LOG_ERROR("[HEAP] Invalid heap %p", (void*)heap);
+        return NULL;
+    }
+    if (size == 0) return NULL;
+
+    pthread_mutex_lock(&heap->lock);
+    void* ptr = heap_malloc_internal(heap, size);
+    pthread_mutex_unlock(&heap->lock);
+
+    return ptr;
+}
+
+void dam_heap_free(dam_heap_t* heap, void* ptr) {
+    if (!ptr) return;
+
+    if (!heap_is_valid(heap)) {
+        DAM_LOG_ERROR("[HEAP] Invalid heap %p", (void*)heap);
+        return;
+    }
+
+    pthread_mutex_lock(&heap->lock);
+
+    pool_header_t* pool_header = heap_pool_from_ptr(heap, ptr);
+    if (pool_header) heap_free_internal(heap, ptr, pool_header);
+    else DAM_LOG_ERROR("[HEAP] Pointer %p does not belong to heap %p", ptr, (void*)heap);
+
+    pthread_mutex_unlock(&heap->lock);
+}
+
+// Grows in place when the block has room, otherwise moves within the same heap.
+void* dam_heap_realloc(dam_heap_t* heap, void* ptr, size_t size) {
+    if (!ptr) return dam_heap_malloc(heap, size);
+
+    if (size == 0) {
+        dam_heap_free(heap, ptr);
+        return NULL;
+    }
+
+    if (!heap_is_valid(heap)) {
+        DAM_LOG_ERROR("[HEAP] Invalid heap %p", (void*)heap);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&heap->lock);
+
+    pool_header_t* pool_header = heap_pool_from_ptr(heap, ptr);
+    if (!pool_header) {
+        pthread_mutex_unlock(&heap->lock);
+        DAM_LOG_ERROR("[HEAP] Pointer %p does not belong to heap %p", ptr, (void*)heap);
+        return NULL;
+    }
+
+    size_t capacity = heap_capacity(ptr, pool_header);
+
+    if (size <= capacity) {
+        if (pool_header->type == DAM_LAYER_GENERAL) {
+            block_header_t* block_header = get_block_header(ptr);
+            block_header->user_size = size;
+            *(uint32_t*)((char*)ptr + size) = CANARY_VALUE;
+        }
+        pthread_mutex_unlock(&heap->lock);
+        return ptr;
+    }
+
+    size_t old_size = pool_header->type == DAM_LAYER_SMALL ? capacity : get_block_header(ptr)->user_size;
+
+    void* new_ptr = heap_malloc_internal(heap, size);
+    if (new_ptr) {
+        dam_memcpy(new_ptr, ptr, old_size);
+        heap_free_internal(heap, ptr, pool_header);
+    }
+
+    pthread_mutex_unlock(&heap->lock);
+    return new_ptr;
+}
+
+/*
+ * Unmaps every pool of the heap at once, live allocations included. Objects are not visited.
+ * The heap must not be used by any thread anymore.
+ */
+void dam_heap_destroy(dam_heap_t* heap) {
+    if (!heap_is_valid(heap)) {
+        DAM_LOG_ERROR("[HEAP] Invalid heap %p", (void*)heap);
+        return;
+    }
+
+    pthread_mutex_lock(&heap->lock);
+
+    size_t released = 0;
+    pool_header_t* pool_header = heap->pools;
+    while (pool_header) {
+        pool_header_t* next = pool_header->heap_next;
+
+        dam_unregister_pool(pool_header);
+        munmap(pool_header->memory, pool_header->size);
+        released++;
+
+        pool_header = next;
+    }
+
+    heap->pools = NULL;
+    heap->magic = HEAP_DESTROYED_MAGIC;
+
+    pthread_mutex_unlock(&heap->lock);
+    pthread_mutex_destroy(&heap->lock);
+
+    DAM_LOG("[HEAP] Destroyed heap %p, %zu pools released", (void*)heap, released);
+    munmap(heap, sizeof(dam_heap_t));
+}
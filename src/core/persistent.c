@@ -0,0 +1,177 @@
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dam/dam.h"
+#include "dam/dam_config.h"
+#include "dam/dam_log.h"
+#include "dam/internal/dam_internal.h"
+
+/**********************************************************
+ * Persistent heap
+ *
+ * file                     ← flock, one process at a time
+ * └─ region                ← mapped MAP_SHARED, written back by msync
+ *     └─ root              ← offset of the caller's entry object
+ *
+ * A restarted process maps the file again and finds its data through
+ * the root, all links inside the region are offsets so the mapping
+ * address does not matter. A heap not closed cleanly is walked block
+ * by block on open and refused when its metadata is torn.
+ **********************************************************/
+
+// Writes the header page back on its own, so the dirty flag reaches the file before any data does.
+static int persistent_sync_header(dam_persistent_heap_t* heap) {
+    return msync(heap->region, PAGE_SIZE, MS_SYNC);
+}
+
+static dam_persistent_heap_t* persistent_map(int fd, size_t size, uint8_t create) {
+    void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        DAM_LOG_ERROR("[PERSISTENT] mmap failed for %zu bytes", size);
+        return NULL;
+    }
+
+    dam_region_header_t* region = memory;
+    if (create ? !dam_region_init(region, size) : !dam_region_validate(region, size)) {
+        munmap(memory, size);
+        return NULL;
+    }
+
+    if (!create) {
+        if (region->is_dirty) {
+            DAM_LOG_ERROR("[PERSISTENT] Heap %p was not closed cleanly, checking its blocks", memory);
+            if (!dam_region_check(region)) {
+                DAM_LOG_ERROR("[PERSISTENT] Heap %p is torn, refusing to open it", memory);
+                munmap(memory, size);
+                return NULL;
+            }
+        }
+
+        // The file lock makes this the only process, whatever state the saved lock is in.
+        if (!dam_region_reset_lock(region)) {
+            munmap(memory, size);
+            return NULL;
+        }
+    }
+
+    dam_persistent_heap_t* heap = dam_malloc(sizeof(dam_persistent_heap_t));
+    if (!heap) {
+        munmap(memory, size);
+        return NULL;
+    }
+
+    heap->region = region;
+    heap->size = size;
+    heap->fd = fd;
+
+    region->is_dirty = 1;
+    persistent_sync_header(heap);
+
+    DAM_LOG("[PERSISTENT] Mapped persistent heap at %p (%zu bytes, fd %d)", memory, size, fd);
+    return heap;
+}
+
+/*********************
+ * Public API        *
+ *********************/
+
+/*
+ * Opens the heap stored in the file at path, or creates it with size bytes when the file is new or empty.
+ * An existing file keeps its own size. Returns NULL on failure, also while another process has it open.
+ */
+dam_persistent_heap_t* dam_persistent_open(const char* path, size_t size) {
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        DAM_LOG_ERROR("[PERSISTENT] Failed to open %s", path);
+        return NULL;
+    }
+
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        DAM_LOG_ERROR("[PERSISTENT] %s is in use by another process", path);
+        close(fd);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    uint8_t create = st.st_size == 0;
+    if (create) {
+        size = align_up(size, PAGE_SIZE);
+        if (size == 0 || ftruncate(fd, (off_t)size) != 0) {
+            DAM_LOG_ERROR("[PERSISTENT] Failed to size %s to %zu bytes", path, size);
+            close(fd);
+            return NULL;
+        }
+    } else {
+        size = (size_t)st.st_size;
+    }
+
+    dam_persistent_heap_t* heap = persistent_map(fd, size, create);
+    if (!heap) close(fd);
+    return heap;
+}
+
+// Writes the whole heap back to the file. Returns 0 on success, like msync().
+int dam_persistent_sync(dam_persistent_heap_t* heap) {
+    if (!heap) return -1;
+    return msync(heap->region, heap->size, MS_SYNC);
+}
+
+// Syncs, marks the heap clean and unmaps it. Pointers into it are invalid afterwards.
+void dam_persistent_close(dam_persistent_heap_t* heap) {
+    if (!heap) return;
+
+    // A torn heap stays marked dirty, so the next open checks it.
+    uint8_t locked = dam_region_lock(heap->region);
+    if (dam_persistent_sync(heap) == 0 && locked) {
+        heap->region->is_dirty = 0;
+        persistent_sync_header(heap);
+    } else {
+        DAM_LOG_ERROR("[PERSISTENT] Failed to sync heap %p, it stays marked dirty", (void*)heap->region);
+    }
+    if (locked) dam_region_unlock(heap->region);
+
+    munmap(heap->region, heap->size);
+    close(heap->fd);
+    dam_free(heap);
+}
+
+void* dam_persistent_malloc(dam_persistent_heap_t* heap, size_t size) {
+    if (!heap) return NULL;
+    return dam_region_malloc(heap->region, size);
+}
+
+void dam_persistent_free(dam_persistent_heap_t* heap, void* ptr) {
+    if (!heap) return;
+    dam_region_free(heap->region, ptr);
+}
+
+// NULL until dam_persistent_set_root() was called on this file.
+void* dam_persistent_root(const dam_persistent_heap_t* heap) {
+    if (!heap) return NULL;
+    return dam_region_ptr(heap->region, heap->region->root);
+}
+
+void dam_persistent_set_root(dam_persistent_heap_t* heap, void* ptr) {
+    if (!heap) return;
+
+    if (!dam_region_lock(heap->region)) return;
+    heap->region->root = dam_region_offset(heap->region, ptr);
+    dam_region_unlock(heap->region);
+}
+
+// Offsets stay valid across runs, store them instead of pointers inside the heap.
+uint64_t dam_persistent_offset(const dam_persistent_heap_t* heap, const void* ptr) {
+    return dam_region_offset(heap->region, ptr);
+}
+
+void* dam_persistent_ptr(const dam_persistent_heap_t* heap, uint64_t offset) {
+    return dam_region_ptr(heap->region, offset);
+}
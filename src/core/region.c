@@ -0,0 +1,325 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+
+#include "dam/dam.h"
+#include "dam/dam_config.h"
+#include "dam/dam_log.h"
+#include "dam/internal/dam_internal.h"
+
+/**********************************************************
+ * Region allocator
+ *
+ * dam_region_header_t     ← offset 0, process shared robust lock
+ * ├─ first_block          ← blocks in address order (prev offsets)
+ * └─ free_list            ← linked list (offsets)
+ *
+ * Backs the shared and persistent heaps. A region may be mapped at a
+ * different address in every process or run, so all metadata stores
+ * offsets from the region start. First-fit with split and coalesce,
+ * the same policy as the general layer.
+ **********************************************************/
+
+#define REGION_HEADER_SIZE ALIGN_UP_CONST(sizeof(dam_region_header_t), ALIGNMENT)
+#define REGION_BLOCK_SIZE ALIGN_UP_CONST(sizeof(dam_region_block_t), ALIGNMENT)
+
+static inline dam_region_block_t* block_at(dam_region_header_t* region, dam_offset_t offset) {
+    return offset ? (dam_region_block_t*)((char*)region + offset) : NULL;
+}
+
+// Offset of the block physically after the one at offset, 0 past the end.
+static inline dam_offset_t next_block_offset(const dam_region_header_t* region, dam_offset_t offset, const dam_region_block_t* block) {
+    dam_offset_t next = offset + REGION_BLOCK_SIZE + block->size;
+    return next < region->size ? next : 0;
+}
+
+static void push_free(dam_region_header_t* region, dam_region_block_t* block, dam_offset_t offset) {
+    block->prev_free = 0;
+    block->next_free = region->free_list;
+    if (region->free_list) block_at(region, region->free_list)->prev_free = offset;
+    region->free_list = offset;
+}
+
+static void remove_free(dam_region_header_t* region, dam_region_block_t* block) {
+    if (block->prev_free) block_at(region, block->prev_free)->next_free = block->next_free;
+    else region->free_list = block->next_free;
+
+    if (block->next_free) block_at(region, block->next_free)->prev_free = block->prev_free;
+}
+
+/*
+ * Formats size bytes at region as an empty region. The magic is written last, so a
+ * region that was never fully initialized fails dam_region_validate(). Returns 1 on success.
+ */
+uint8_t dam_region_init(dam_region_header_t* region, size_t size) {
+    size_t end = size & ~(ALIGNMENT - 1);
+    if (end < REGION_HEADER_SIZE + REGION_BLOCK_SIZE + DAM_REGION_MIN_SPLIT) {
+        DAM_LOG_ERROR("[REGION] %zu bytes are too small for a region", size);
+        return 0;
+    }
+
+    if (!dam_region_reset_lock(region)) return 0;
+
+    region->version = DAM_REGION_VERSION;
+    region->size = end;
+    region->first_block = REGION_HEADER_SIZE;
+    region->free_list = 0;
+    region->bytes_used = 0;
+    region->root = 0;
+    region->is_dirty = 0;
+
+    dam_region_block_t* block = block_at(region, REGION_HEADER_SIZE);
+    block->size = end - REGION_HEADER_SIZE - REGION_BLOCK_SIZE;
+    block->prev = 0;
+    block->is_free = 1;
+    block->magic = REGION_FREED_MAGIC;
+    push_free(region, block, REGION_HEADER_SIZE);
+
+    __atomic_store_n(&region->magic, REGION_MAGIC, __ATOMIC_RELEASE);
+
+    DAM_LOG("[REGION] Initialized region %p of %zu bytes", (void*)region, end);
+    return 1;
+}
+
+// Checks the header of a region mapped with mapped_size bytes. Returns 1 when it can be used.
+uint8_t dam_region_validate(const dam_region_header_t* region, size_t mapped_size) {
+    if (__atomic_load_n(&region->magic, __ATOMIC_ACQUIRE) != REGION_MAGIC) {
+        DAM_LOG_ERROR("[REGION] Region %p has no valid magic", (const void*)region);
+        return 0;
+    }
+
+    if (region->version != DAM_REGION_VERSION) {
+        DAM_LOG_ERROR("[REGION] Region %p has layout version %u, expected %d", (const void*)region, region->version, DAM_REGION_VERSION);
+        return 0;
+    }
+
+    if (region->size > mapped_size || region->first_block != REGION_HEADER_SIZE) {
+        DAM_LOG_ERROR("[REGION] Region %p header does not match its mapping of %zu bytes", (const void*)region, mapped_size);
+        return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Walks every block and the free list, checking magics, boundary links and the used byte count.
+ * Catches regions torn by a crash between metadata updates. Caller holds the lock or owns the region.
+ */
+uint8_t dam_region_check(dam_region_header_t* region) {
+    dam_offset_t offset = region->first_block;
+    dam_offset_t prev = 0;
+    uint64_t used = 0;
+    size_t free_blocks = 0;
+
+    while (offset) {
+        if (offset + REGION_BLOCK_SIZE > region->size) {
+            DAM_LOG_VALID_ERROR("Region block offset out of bounds: %llu", (unsigned long long)offset);
+            return 0;
+        }
+
+        dam_region_block_t* block = block_at(region, offset);
+        uint8_t is_free = block->magic == REGION_FREED_MAGIC;
+
+        if ((!is_free && block->magic != REGION_BLOCK_MAGIC) || block->is_free != is_free) {
+            DAM_LOG_VALID_ERROR("Region block magic does not match at offset %llu, magic 0x%X", (unsigned long long)offset, block->magic);
+            return 0;
+        }
+        if (block->prev != prev || offset + REGION_BLOCK_SIZE + block->size > region->size) {
+            DAM_LOG_VALID_ERROR("Region block links are torn at offset %llu", (unsigned long long)offset);
+            return 0;
+        }
+
+        if (is_free) free_blocks++;
+        else used += block->size;
+
+        prev = offset;
+        offset = next_block_offset(region, offset, block);
+    }
+
+    if (used != region->bytes_used) {
+        DAM_LOG_VALID_ERROR("Region used bytes do not add up: %llu counted, %llu recorded", (unsigned long long)used, (unsigned long long)region->bytes_used);
+        return 0;
+    }
+
+    dam_offset_t prev_free = 0;
+    offset = region->free_list;
+    while (offset) {
+        if (free_blocks == 0 || offset + REGION_BLOCK_SIZE > region->size) {
+            DAM_LOG_VALID_ERROR("Region free list is torn at offset %llu", (unsigned long long)offset);
+            return 0;
+        }
+
+        dam_region_block_t* block = block_at(region, offset);
+        if (block->magic != REGION_FREED_MAGIC || block->prev_free != prev_free) {
+            DAM_LOG_VALID_ERROR("Region free list is torn at offset %llu", (unsigned long long)offset);
+            return 0;
+        }
+
+        free_blocks--;
+        prev_free = offset;
+        offset = block->next_free;
+    }
+
+    if (free_blocks != 0) {
+        DAM_LOG_VALID_ERROR("Region free list misses %zu free blocks", free_blocks);
+        return 0;
+    }
+
+    return 1;
+}
+
+// Replaces the lock of a region only this process can have mapped, a saved lock may still read as held.
+uint8_t dam_region_reset_lock(dam_region_header_t* region) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    int result = pthread_mutex_init(&region->lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    if (result != 0) DAM_LOG_ERROR("[REGION] Failed to create process shared lock");
+    return result == 0;
+}
+
+/*
+ * Returns 1 with the lock held. A process that died holding the lock may have been halfway through an update,
+ * its metadata is only taken over when dam_region_check() passes. Otherwise the lock is released without being
+ * made consistent, so the region stays unrecoverable and every later caller gets 0.
+ */
+uint8_t dam_region_lock(dam_region_header_t* region) {
+    int result = pthread_mutex_lock(&region->lock);
+    if (result == 0) return 1;
+
+    if (result == EOWNERDEAD) {
+        if (dam_region_check(region)) {
+            DAM_LOG_ERROR("[REGION] Lock owner of region %p died, metadata intact, recovering", (void*)region);
+            pthread_mutex_consistent(&region->lock);
+            return 1;
+        }
+        DAM_LOG_ERROR("[REGION] Lock owner of region %p died mid update, region is torn", (void*)region);
+        pthread_mutex_unlock(&region->lock);
+        return 0;
+    }
+
+    DAM_LOG_ERROR("[REGION] Region %p is unrecoverable", (void*)region);
+    return 0;
+}
+
+void dam_region_unlock(dam_region_header_t* region) {
+    pthread_mutex_unlock(&region->lock);
+}
+
+void* dam_region_malloc(dam_region_header_t* region, size_t size) {
+    if (size == 0 || size > region->size) return NULL;
+    size_t needed = align_up(size, ALIGNMENT);
+
+    if (!dam_region_lock(region)) return NULL;
+
+    dam_offset_t offset = region->free_list;
+    dam_region_block_t* block = NULL;
+    while (offset) {
+        block = block_at(region, offset);
+        if (block->size >= needed) break;
+        offset = block->next_free;
+    }
+
+    if (!offset) {
+        dam_region_unlock(region);
+        DAM_LOG_ERROR("[REGION] Region %p has no free block of %zu bytes", (void*)region, needed);
+        return NULL;
+    }
+
+    remove_free(region, block);
+
+    if (block->size >= needed + REGION_BLOCK_SIZE + DAM_REGION_MIN_SPLIT) {
+        dam_offset_t rest_offset = offset + REGION_BLOCK_SIZE + needed;
+        dam_region_block_t* rest = block_at(region, rest_offset);
+
+        rest->size = block->size - needed - REGION_BLOCK_SIZE;
+        rest->prev = offset;
+        rest->is_free = 1;
+        rest->magic = REGION_FREED_MAGIC;
+
+        dam_offset_t after = next_block_offset(region, rest_offset, rest);
+        if (after) block_at(region, after)->prev = rest_offset;
+
+        block->size = needed;
+        push_free(region, rest, rest_offset);
+    }
+
+    block->is_free = 0;
+    block->magic = REGION_BLOCK_MAGIC;
+    region->bytes_used += block->size;
+
+    dam_region_unlock(region);
+    return (char*)block + REGION_BLOCK_SIZE;
+}
+
+void dam_region_free(dam_region_header_t* region, void* ptr) {
+    if (!ptr) return;
+
+    uintptr_t start = (uintptr_t)region + REGION_HEADER_SIZE + REGION_BLOCK_SIZE;
+    if ((uintptr_t)ptr < start || (uintptr_t)ptr >= (uintptr_t)region + region->size || (uintptr_t)ptr % ALIGNMENT != 0) {
+        DAM_LOG_ERROR("[REGION] Pointer %p does not belong to region %p", ptr, (void*)region);
+        return;
+    }
+
+    dam_offset_t offset = (dam_offset_t)((char*)ptr - (char*)region) - REGION_BLOCK_SIZE;
+
+    if (!dam_region_lock(region)) return;
+
+    dam_region_block_t* block = block_at(region, offset);
+    if (block->magic == REGION_FREED_MAGIC) {
+        dam_region_unlock(region);
+        DAM_LOG_ERROR("[REGION] Double free detected at %p!", ptr);
+        return;
+    }
+    if (block->magic != REGION_BLOCK_MAGIC) {
+        dam_region_unlock(region);
+        DAM_LOG_ERROR("[REGION] Invalid pointer passed to region free: %p", ptr);
+        return;
+    }
+
+    region->bytes_used -= block->size;
+    block->is_free = 1;
+    block->magic = REGION_FREED_MAGIC;
+
+    // Coalesce with the next block
+    dam_offset_t next_offset = next_block_offset(region, offset, block);
+    dam_region_block_t* next = block_at(region, next_offset);
+    if (next && next->is_free) {
+        remove_free(region, next);
+        block->size += REGION_BLOCK_SIZE + next->size;
+        next->magic = 0;
+
+        dam_offset_t after = next_block_offset(region, offset, block);
+        if (after) block_at(region, after)->prev = offset;
+    }
+
+    // Coalesce with the previous block
+    dam_region_block_t* prev = block_at(region, block->prev);
+    if (prev && prev->is_free) {
+        remove_free(region, prev);
+        prev->size += REGION_BLOCK_SIZE + block->size;
+        block->magic = 0;
+
+        offset = block->prev;
+        block = prev;
+
+        dam_offset_t after = next_block_offset(region, offset, block);
+        if (after) block_at(region, after)->prev = offset;
+    }
+
+    push_free(region, block, offset);
+
+    dam_region_unlock(region);
+}
+
+// Offsets are the only form of a region pointer that means the same in every mapping.
+inline dam_offset_t dam_region_offset(const dam_region_header_t* region, const void* ptr) {
+    return ptr ? (dam_offset_t)((const char*)ptr - (const char*)region) : 0;
+}
+
+inline void* dam_region_ptr(dam_region_header_t* region, dam_offset_t offset) {
+    return offset && offset < region->size ? (char*)region + offset : NULL;
+}
@@ -0,0 +1,135 @@
+#define _GNU_SOURCE // memfd_create
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "dam/dam.h"
+#include "dam/dam_config.h"
+#include "dam/dam_log.h"
+#include "dam/internal/dam_internal.h"
+
+/**********************************************************
+ * Shared heap
+ *
+ * memfd / shm_open object
+ * └─ region                ← mapped MAP_SHARED by every process
+ *
+ * Processes exchange allocations as offsets (dam_shared_offset /
+ * dam_shared_ptr), each one maps the region at its own address.
+ **********************************************************/
+
+static dam_shared_heap_t* shared_map(int fd, size_t size, uint8_t create) {
+    void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        DAM_LOG_ERROR("[SHARED] mmap failed for %zu bytes", size);
+        return NULL;
+    }
+
+    if (create ? !dam_region_init(memory, size) : !dam_region_validate(memory, size)) {
+        munmap(memory, size);
+        return NULL;
+    }
+
+    dam_shared_heap_t* heap = dam_malloc(sizeof(dam_shared_heap_t));
+    if (!heap) {
+        munmap(memory, size);
+        return NULL;
+    }
+
+    heap->region = memory;
+    heap->size = size;
+    heap->fd = fd;
+
+    DAM_LOG("[SHARED] Mapped shared heap at %p (%zu bytes, fd %d)", memory, size, fd);
+    return heap;
+}
+
+/*
+ * Creates a shared heap of size bytes. A name creates a POSIX shared memory object other processes
+ * open with dam_shared_open(), NULL creates an anonymous memfd to pass on by fork() or fd passing.
+ * Returns NULL on failure, also when the name already exists.
+ */
+dam_shared_heap_t* dam_shared_create(const char* name, size_t size) {
+    size = align_up(size, PAGE_SIZE);
+
+    int fd = name ? shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600) : memfd_create("dam_shared", MFD_CLOEXEC);
+    if (fd < 0) {
+        DAM_LOG_ERROR("[SHARED] Failed to create shared memory object %s", name ? name : "(memfd)");
+        return NULL;
+    }
+
+    if (ftruncate(fd, (off_t)size) != 0) {
+        DAM_LOG_ERROR("[SHARED] Failed to size shared memory object to %zu bytes", size);
+        close(fd);
+        if (name) shm_unlink(name);
+        return NULL;
+    }
+
+    dam_shared_heap_t* heap = shared_map(fd, size, 1);
+    if (!heap) {
+        close(fd);
+        if (name) shm_unlink(name);
+    }
+    return heap;
+}
+
+// Maps a heap made by dam_shared_create() from an fd, e.g. a memfd received from another process.
+dam_shared_heap_t* dam_shared_open_fd(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        DAM_LOG_ERROR("[SHARED] fd %d is not a shared heap", fd);
+        return NULL;
+    }
+
+    return shared_map(fd, (size_t)st.st_size, 0);
+}
+
+dam_shared_heap_t* dam_shared_open(const char* name) {
+    int fd = shm_open(name, O_RDWR, 0600);
+    if (fd < 0) {
+        DAM_LOG_ERROR("[SHARED] Failed to open shared memory object %s", name);
+        return NULL;
+    }
+
+    dam_shared_heap_t* heap = dam_shared_open_fd(fd);
+    if (!heap) close(fd);
+    return heap;
+}
+
+// Unmaps the heap in this process only, the memory lives on while any process maps it or the name exists.
+void dam_shared_close(dam_shared_heap_t* heap) {
+    if (!heap) return;
+
+    munmap(heap->region, heap->size);
+    close(heap->fd);
+    dam_free(heap);
+}
+
+int dam_shared_unlink(const char* name) {
+    return shm_unlink(name);
+}
+
+int dam_shared_fd(const dam_shared_heap_t* heap) {
+    return heap ? heap->fd : -1;
+}
+
+void* dam_shared_malloc(dam_shared_heap_t* heap, size_t size) {
+    if (!heap) return NULL;
+    return dam_region_malloc(heap->region, size);
+}
+
+void dam_shared_free(dam_shared_heap_t* heap, void* ptr) {
+    if (!heap) return;
+    dam_region_free(heap->region, ptr);
+}
+
+// 0 stands for NULL, no allocation ever sits at offset 0.
+uint64_t dam_shared_offset(const dam_shared_heap_t* heap, const void* ptr) {
+    return dam_region_offset(heap->region, ptr);
+}
+
+void* dam_shared_ptr(const dam_shared_heap_t* heap, uint64_t offset) {
+    return dam_region_ptr(heap->region, offset);
+}
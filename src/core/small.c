@@ -23,35 +23,39 @@
  **********************************************************/
 static size_class_t size_classes[DAM_SIZE_CLASS_COUNT];
 
-void dam_small_init(void) {
+// Heaps keep their own class lists, NULL selects the global ones.
+static inline size_class_t* classes_of(dam_heap_t* heap) {
+    return heap ? heap->size_classes : size_classes;
+}
+
+static void init_size_classes(size_class_t* classes) {
     size_t block_size = DAM_SMALL_MIN;
 
     for (size_t i = 0; i < DAM_SIZE_CLASS_COUNT; i++) {
-        size_classes[i].block_size = block_size;
-        size_classes[i].free_class_list = NULL;
-        size_classes[i].pools = NULL;
+        classes[i].block_size = block_size;
+        classes[i].free_class_list = NULL;
+        classes[i].pools = NULL;
         block_size *= SIZE_CLASS_MULTIPLIER;
     }
+}
+
+void dam_small_init(void) {
+    init_size_classes(size_classes);
 
     DAM_LOG("[INIT] Small allocator initialized (%d classes)", DAM_SIZE_CLASS_COUNT);
 }
 
-static pool_header_t* create_small_pool(uint8_t class_index) {
-    size_t usable_bytes = (sizeof(size_class_header_t) + size_classes[class_index].block_size) * SIZE_CLASS_BLOCKS_PER_POOL;
+static pool_header_t* create_small_pool(dam_heap_t* heap, uint8_t class_index) {
+    size_class_t* classes = classes_of(heap);
+    size_t usable_bytes = (sizeof(size_class_header_t) + classes[class_index].block_size) * SIZE_CLASS_BLOCKS_PER_POOL;
     size_t pool_size = align_up( sizeof(pool_header_t) + usable_bytes, ALIGNMENT);
 
-    DAM_LOG("[POOL] Creating size class pool for class %zuB with total size of %zuB...", size_classes[class_index].block_size, pool_size);
+    DAM_LOG("[POOL] Creating size class pool for class %zuB with total size of %zuB...", classes[class_index].block_size, pool_size);
 
-    void* memory = mmap(
-        NULL,
-        pool_size,
-        PROT_READ | PROT_WRITE,
-        MAP_PRIVATE | MAP_ANONYMOUS,
-        -1,
-        0
-    );
+    uint8_t is_huge;
+    void* memory = dam_map_pool(pool_size, &is_huge);
 
-    if (memory == MAP_FAILED) {
+    if (!memory) {
         DAM_LOG_ERROR("mmap failed for new pool");
         return NULL;
     }
@@ -60,10 +64,16 @@ static pool_header_t* create_small_pool(uint8_t class_index) {
     new_pool->memory = memory;
     new_pool->size = pool_size;
     new_pool->type = DAM_LAYER_SMALL;
+    new_pool->is_huge = is_huge;
+    new_pool->heap = heap;
 
     dam_register_pool(new_pool);
+    if (heap) {
+        new_pool->heap_next = heap->pools;
+        heap->pools = new_pool;
+    }
 
-    size_t block_stride = SIZE_CLASS_HEADER_SIZE + size_classes[class_index].block_size;
+    size_t block_stride = SIZE_CLASS_HEADER_SIZE + classes[class_index].block_size;
     char* cursor = (char*)memory + align_up(sizeof(pool_header_t), ALIGNMENT);
     char* pool_end = (char*)memory + pool_size;
 
@@ -88,14 +98,46 @@ static pool_header_t* create_small_pool(uint8_t class_index) {
     if (free_class_list) {
         size_class_header_t* tail = free_class_list;
         while (tail->next) tail = tail->next;
-        tail->next = size_classes[class_index].free_class_list;
+        tail->next = classes[class_index].free_class_list;
     }
-    size_classes[class_index].free_class_list = free_class_list;
+    classes[class_index].free_class_list = free_class_list;
 
     DAM_LOG("[POOL] Created at %p with %zu bytes usable. Total pools: %zu", memory, pool_size, stats.pools_created);
     return new_pool;
 }
 
+/*
+ * Makes sure `bytes` worth of blocks are free in a class, creating pools as needed.
+ * New pools are prefaulted according to flags.
+ */
+uint8_t dam_small_reserve(uint8_t class_index, size_t bytes, unsigned flags) {
+    if (class_index >= DAM_SIZE_CLASS_COUNT) return 0;
+
+    dam_small_lock();
+
+    size_t needed = (bytes + size_classes[class_index].block_size - 1) / size_classes[class_index].block_size;
+    size_t available = 0;
+    size_class_header_t* block = size_classes[class_index].free_class_list;
+    while (block && available < needed) {
+        available++;
+        block = block->next;
+    }
+
+    uint8_t result = 1;
+    while (available < needed) {
+        pool_header_t* pool = create_small_pool(NULL, class_index);
+        if (!pool) {
+            result = 0;
+            break;
+        }
+        if (!dam_prefault(pool->memory, pool->size, flags)) result = 0;
+        available += SIZE_CLASS_BLOCKS_PER_POOL;
+    }
+
+    dam_small_unlock();
+    return result;
+}
+
 // These two functions can be optimized to be O(1) rather then O(n)
 uint8_t size_to_class(size_t size, uint8_t traced) {
 
@@ -115,11 +157,11 @@ size_t class_to_size(uint8_t class_index) {
         return size_classes[class_index].block_size;
 }
 
-void* dam_small_malloc_internal(size_t size, const char* trace) {
-    uint8_t class = size_to_class(size, trace != NULL ? 1 : 0);
-    size_class_t* size_class = &size_classes[class];
+// Takes a block off the central list of class, creating a pool when it is empty. Caller holds the lock.
+static size_class_header_t* small_pop_class(dam_heap_t* heap, uint8_t class) {
+    size_class_t* size_class = &classes_of(heap)[class];
 
-    if (!size_class->free_class_list && !create_small_pool(class)) {
+    if (!size_class->free_class_list && !create_small_pool(heap, class)) {
         DAM_LOG_ERROR("[ALLOC] No free list and Could not create new pool.");
         return NULL;
     }
@@ -130,7 +172,14 @@ void* dam_small_malloc_internal(size_t size, const char* trace) {
     DAM_LOG("[ALLOC] Found free size class block: class=%u (%zuB) block=%p", class, size_class->block_size, (void*)block);
 
     block->is_free = 0;
+    block->is_traced = 0;
     block->magic = SMALL_MAGIC;
+    return block;
+}
+
+static void* small_malloc_from(dam_heap_t* heap, size_t size, const char* trace) {
+    size_class_header_t* block = small_pop_class(heap, size_to_class(size, trace != NULL ? 1 : 0));
+    if (!block) return NULL;
 
     void* ptr;
 
@@ -149,6 +198,10 @@ void* dam_small_malloc_internal(size_t size, const char* trace) {
     return ptr;
 }
 
+void* dam_small_malloc_internal(size_t size, const char* trace) {
+    return small_malloc_from(NULL, size, trace);
+}
+
 void* dam_small_malloc(size_t size, const char* trace) {
     uint8_t class = size_to_class(size, trace != NULL ? 1 : 0);
 
@@ -190,17 +243,91 @@ void* dam_small_malloc(size_t size, const char* trace) {
     return ptr;
 }
 
+// Skips the thread cache and takes the block straight from the central class list.
+void* dam_small_malloc_from_central(size_t size, const char* trace) {
+    dam_small_lock();
+    void* ptr = dam_small_malloc_internal(size, trace);
+    dam_small_unlock();
+
+    return ptr;
+}
+
+static inline void* small_take_block(size_class_header_t* block) {
+    block->is_free = 0;
+    block->is_traced = 0;
+    block->magic = SMALL_MAGIC;
+    block->next = NULL;
+
+    return (char*)block + SIZE_CLASS_HEADER_SIZE;
+}
+
+// dam_small_malloc() for a class the caller already knows, e.g. computed at compile time. Never traced.
+void* dam_small_class_malloc(uint8_t class) {
+    thread_cache_t* thread_cache = dam_get_thread_cache();
+    if (thread_cache && thread_cache->tc_bins[class].free_list) {
+        size_class_header_t* block = thread_cache->tc_bins[class].free_list;
+        thread_cache->tc_bins[class].free_list = block->next;
+        thread_cache->tc_bins[class].count--;
+        return small_take_block(block);
+    }
+
+    dam_small_lock();
+    size_class_header_t* block = small_pop_class(NULL, class);
+    dam_small_unlock();
+
+    return block ? (char*)block + SIZE_CLASS_HEADER_SIZE : NULL;
+}
+
+/*
+ * Fills out[] with up to count blocks of one class, first from the thread cache chain and then
+ * from the central list under a single lock. Returns how many blocks were allocated.
+ */
+size_t dam_small_malloc_batch(size_t size, size_t count, void** out) {
+    uint8_t class = size_to_class(size, 0);
+    size_t allocated = 0;
+
+    thread_cache_t* thread_cache = dam_get_thread_cache();
+    if (thread_cache) {
+        thread_cache_bin_t* bin = &thread_cache->tc_bins[class];
+        while (allocated < count && bin->free_list) {
+            size_class_header_t* block = bin->free_list;
+            bin->free_list = block->next;
+            bin->count--;
+            out[allocated++] = small_take_block(block);
+        }
+    }
+
+    if (allocated == count) return allocated;
+
+    dam_small_lock();
+
+    size_class_t* size_class = &size_classes[class];
+    while (allocated < count) {
+        if (!size_class->free_class_list && !create_small_pool(NULL, class)) {
+            DAM_LOG_ERROR("[ALLOC] Batch stopped after %zu blocks, could not create new pool.", allocated);
+            break;
+        }
+
+        size_class_header_t* block = size_class->free_class_list;
+        size_class->free_class_list = block->next;
+        out[allocated++] = small_take_block(block);
+    }
+
+    dam_small_unlock();
+    return allocated;
+}
+
 void* dam_small_realloc(void* ptr, size_t size, size_class_header_t* size_class_header, const char* trace) {
-    uint8_t current_index = size_class_header->size_class_index;
+    size_t usable_size = dam_small_usable_size(ptr, size_class_header);
 
     // Check if cross layer before locking
     if (size > DAM_SMALL_MAX) {
-        size_t copy_size = size_classes[current_index].block_size;
+        size_t copy_size = usable_size;
 
         void* new_ptr = dam_trace_malloc(size, trace); // Locks accounted for.
         if (new_ptr) {
             memcpy(new_ptr, ptr, copy_size);
-            dam_free(ptr);
+            dam_small_free(ptr, size_class_header);
         }
         return new_ptr;
     }
@@ -208,8 +335,7 @@ void* dam_small_realloc(void* ptr, size_t size, size_class_header_t* size_class_
     dam_small_lock();
 
     // Not shrink on purpose
-    uint8_t requested_index = size_to_class(size, trace != NULL ? 1 : 0);
-    if (size_classes[requested_index].block_size <= size_classes[current_index].block_size) {
+    if (size <= usable_size) {
         dam_small_unlock();
         return ptr;
     }
@@ -217,7 +343,7 @@ void* dam_small_realloc(void* ptr, size_t size, size_class_header_t* size_class_
     // Grow
     void* new_ptr = dam_small_malloc_internal(size, trace);
     if (new_ptr) {
-        size_t copy_size = size_classes[current_index].block_size;
+        size_t copy_size = usable_size;
         memcpy(new_ptr, ptr, copy_size);
         dam_small_free_internal(ptr, size_class_header);
     }
@@ -226,7 +352,7 @@ void* dam_small_realloc(void* ptr, size_t size, size_class_header_t* size_class_
     return new_ptr;
 }
 
-void dam_small_free_internal(void* ptr, size_class_header_t* size_class_header) {
+static void small_free_to(size_class_t* classes, void* ptr, size_class_header_t* size_class_header) {
     // Double free checks
     if (size_class_header->magic == SMALL_FREED_MAGIC) {
         DAM_LOG_ERROR("[FREE] Double free detected at %p!", ptr);
@@ -243,24 +369,30 @@ void dam_small_free_internal(void* ptr, size_class_header_t* size_class_header)
     size_class_header->is_free = 1;
     size_class_header->magic = SMALL_FREED_MAGIC;
 
-    size_class_header->next = size_classes[class].free_class_list;
-    size_classes[class].free_class_list = size_class_header;
+    size_class_header->next = classes[class].free_class_list;
+    classes[class].free_class_list = size_class_header;
 
     DAM_LOG("[FREE] Pointer %p freed", ptr);
 }
 
+void dam_small_free_internal(void* ptr, size_class_header_t* size_class_header) {
+    small_free_to(size_classes, ptr, size_class_header);
+}
+
 void dam_small_free(void* ptr, size_class_header_t* size_class_header) {
-    size_class_header_t* header = get_size_class_header(ptr);
-    uint8_t class = header->size_class_index;
+    dam_small_class_free(ptr, size_class_header, size_class_header->size_class_index);
+}
 
+// dam_small_free() with the class known up front instead of read from the header.
+void dam_small_class_free(void* ptr, size_class_header_t* size_class_header, uint8_t class) {
     // Attempt fast path.
     thread_cache_t* thread_cache = dam_get_thread_cache();
     if (thread_cache && thread_cache->tc_bins[class].count < THREAD_CACHE_MAX_BLOCKS_PER_CLASS) {
 
-        header->is_free = 1;
-        header->magic = SMALL_FREED_MAGIC;
-        header->next = thread_cache->tc_bins[class].free_list;
-        thread_cache->tc_bins[class].free_list = header;
+        size_class_header->is_free = 1;
+        size_class_header->magic = SMALL_FREED_MAGIC;
+        size_class_header->next = thread_cache->tc_bins[class].free_list;
+        thread_cache->tc_bins[class].free_list = size_class_header;
         thread_cache->tc_bins[class].count++;
 
         DAM_LOG("[TCACHE] Cached block %p (class=%u, cached=%zu/%d)", ptr, class, tc->bins[class].count, THREAD_CACHE_MAX_BLOCKS_PER_CLASS);
@@ -275,12 +407,86 @@ void dam_small_free(void* ptr, size_class_header_t* size_class_header) {
     dam_small_free_internal(ptr, size_class_header);
     dam_small_unlock();
 }
+// Refills the thread cache first, whatever does not fit goes to the central lists under one lock.
+void dam_small_free_batch(void** ptrs, size_t count) {
+    thread_cache_t* thread_cache = dam_get_thread_cache();
+    uint8_t locked = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        size_class_header_t* size_class_header = get_size_class_header(ptrs[i]);
+        uint8_t class = size_class_header->size_class_index;
+
+        if (thread_cache && thread_cache->tc_bins[class].count < THREAD_CACHE_MAX_BLOCKS_PER_CLASS) {
+            size_class_header->is_free = 1;
+            size_class_header->magic = SMALL_FREED_MAGIC;
+            size_class_header->next = thread_cache->tc_bins[class].free_list;
+            thread_cache->tc_bins[class].free_list = size_class_header;
+            thread_cache->tc_bins[class].count++;
+            continue;
+        }
+
+        if (!locked) {
+            dam_small_lock();
+            locked = 1;
+        }
+        dam_small_free_internal(ptrs[i], size_class_header);
+    }
+
+    if (locked) dam_small_unlock();
+}
+
 inline size_class_header_t* get_size_class_trace_header(void* ptr) {
     return (size_class_header_t*)((char*)ptr - SIZE_CLASS_HEADER_SIZE - TRACE_SIZE);
 }
 
+// Aligned pointers sit behind a shadow header whose padding is the distance to the real one, in ALIGNMENT units.
 inline size_class_header_t* get_size_class_header(void* ptr) {
-    return (size_class_header_t*)((char*)ptr - SIZE_CLASS_HEADER_SIZE);
+    size_class_header_t* size_class_header = (size_class_header_t*)((char*)ptr - SIZE_CLASS_HEADER_SIZE);
+    if (size_class_header->magic == SMALL_SHADOW_MAGIC) {
+        size_class_header = (size_class_header_t*)((char*)size_class_header - size_class_header->padding * ALIGNMENT);
+    }
+    return size_class_header;
+}
+
+// Bytes usable from ptr on, less than the class size for traced and aligned pointers.
+size_t dam_small_usable_size(void* ptr, const size_class_header_t* size_class_header) {
+    size_t offset = (char*)ptr - ((char*)size_class_header + SIZE_CLASS_HEADER_SIZE);
+    return size_classes[size_class_header->size_class_index].block_size - offset;
+}
+
+/*
+ * Moves a fresh block, allocated with `alignment - ALIGNMENT` bytes of slack, to its first aligned address.
+ * A shadow header in the skipped bytes leads get_size_class_header() back to the real one.
+ */
+void* dam_small_align_block(void* ptr, size_t alignment) {
+    size_t offset = align_up((uintptr_t)ptr, alignment) - (uintptr_t)ptr;
+    if (!offset) return ptr;
+
+    size_class_header_t* size_class_header = get_size_class_header(ptr);
+    char* aligned = (char*)ptr + offset;
+
+    size_class_header_t* shadow = (size_class_header_t*)(aligned - SIZE_CLASS_HEADER_SIZE);
+    *shadow = *size_class_header;
+    shadow->magic = SMALL_SHADOW_MAGIC;
+    shadow->padding = (uint8_t)(offset / ALIGNMENT);
+
+    return aligned;
+}
+
+/*
+ * Heap variants, the caller holds the heap lock.
+ * Heap blocks never pass through the thread cache, which is shared by every heap of a thread.
+ */
+void dam_small_heap_init(dam_heap_t* heap) {
+    init_size_classes(heap->size_classes);
+}
+
+void* dam_small_heap_malloc(dam_heap_t* heap, size_t size) {
+    return small_malloc_from(heap, size, NULL);
+}
+
+void dam_small_heap_free(dam_heap_t* heap, void* ptr, size_class_header_t* size_class_header) {
+    small_free_to(heap->size_classes, ptr, size_class_header);
 }
 
 void dam_small_free_to_central(void* ptr, size_class_header_t* size_class_header) {
@@ -289,6 +495,24 @@ void dam_small_free_to_central(void* ptr, size_class_header_t* size_class_header
     dam_small_unlock();
 }
 
+// Splices every bin of a thread cache onto the central lists, the blocks are already marked free.
+void dam_small_flush_thread_cache(thread_cache_t* thread_cache) {
+    dam_small_lock();
+    for (size_t class = 0; class < DAM_SIZE_CLASS_COUNT; class++) {
+        size_class_header_t* head = thread_cache->tc_bins[class].free_list;
+        if (!head) continue;
+
+        size_class_header_t* tail = head;
+        while (tail->next) tail = tail->next;
+        tail->next = size_classes[class].free_class_list;
+        size_classes[class].free_class_list = head;
+
+        thread_cache->tc_bins[class].free_list = NULL;
+        thread_cache->tc_bins[class].count = 0;
+    }
+    dam_small_unlock();
+}
+
 void dam_snapshot_small(dam_snapshot_t* snapshot) {
     thread_cache_t* tlc = dam_get_current_thread_cache();
     for (size_t class = 0; class < DAM_SIZE_CLASS_COUNT; class++) {
@@ -296,15 +520,18 @@ void dam_snapshot_small(dam_snapshot_t* snapshot) {
     }
     snapshot->tlc_free = (DAM_SIZE_CLASS_COUNT * THREAD_CACHE_MAX_BLOCKS_PER_CLASS) - snapshot->tlc_used;
     snapshot->size_classes = DAM_SIZE_CLASS_COUNT;
-    pool_header_t* current = dam_pool_list;
     dam_small_lock();
+    dam_pool_list_read_lock();
+    pool_header_t* current = dam_pool_list;
     while (current) {
         if (current->type == DAM_LAYER_SMALL) {
             snapshot->classes_bytes_used += current->size;
+            if (current->is_huge) snapshot->huge_page_bytes += current->size;
         }
         current = current->next;
     }
 
+    dam_pool_list_unlock();
     dam_small_unlock();
 }
 
@@ -0,0 +1,447 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "dam/dam.h"
+#include "dam/dam_config.h"
+#include "dam/dam_log.h"
+#include "dam/internal/dam_internal.h"
+
+/**********************************************************
+ * Span allocator
+ *
+ * span_chunks             ← linked list (span chunks)
+ * └─ span_chunk_t         ← DAM_LAYER_SPAN, also in dam_pool_list
+ *     ├─ used[]           ← bitmap (one bit per page)
+ *     └─ spans[]          ← array (metadata per first page)
+ *
+ * Serves DAM_GENERAL_MAX < n <= DAM_SPAN_MAX as page granular runs
+ * carved first-fit out of a few big chunks, instead of one mapping per
+ * object. Chunks are aligned to DAM_SPAN_CHUNK_SIZE so the owning chunk
+ * of a pointer is found by masking. Metadata is kept out of line, so
+ * payloads are page aligned. Traced spans keep their trace in the first
+ * TRACE_SIZE bytes of the first page.
+ **********************************************************/
+static span_chunk_t* span_chunks = NULL;
+
+void dam_span_init(void) {}
+
+static span_chunk_t* create_span_chunk(void) {
+    span_chunk_t* span_chunk = dam_map_aligned(DAM_SPAN_CHUNK_SIZE, DAM_SPAN_CHUNK_SIZE);
+
+    if (!span_chunk) {
+        DAM_LOG_ERROR("mmap failed for new span chunk");
+        return NULL;
+    }
+
+    span_chunk->pool.memory = span_chunk;
+    span_chunk->pool.size = DAM_SPAN_CHUNK_SIZE;
+    span_chunk->pool.type = DAM_LAYER_SPAN;
+    span_chunk->pool.is_huge = dam_advise_huge(span_chunk, DAM_SPAN_CHUNK_SIZE);
+    span_chunk->first_page = align_up(sizeof(span_chunk_t), PAGE_SIZE) / PAGE_SIZE;
+    span_chunk->free_pages = DAM_SPAN_CHUNK_PAGES - span_chunk->first_page;
+
+    span_chunk->next = span_chunks;
+    span_chunks = span_chunk;
+    dam_register_pool(&span_chunk->pool);
+
+    DAM_LOG("[SPAN] Created chunk at %p with %zu usable pages", (void*)span_chunk, span_chunk->free_pages);
+    return span_chunk;
+}
+
+static void release_span_chunk(span_chunk_t* span_chunk) {
+    span_chunk_t** current = &span_chunks;
+    while (*current) {
+        if (*current == span_chunk) {
+            *current = span_chunk->next;
+            break;
+        }
+        current = &(*current)->next;
+    }
+
+    dam_unregister_pool(&span_chunk->pool);
+    DAM_LOG("[SPAN] Releasing empty chunk %p", (void*)span_chunk);
+    munmap(span_chunk, DAM_SPAN_CHUNK_SIZE);
+}
+
+static inline uint8_t span_page_used(const span_chunk_t* span_chunk, size_t page) {
+    return (span_chunk->used[page / 64] >> (page % 64)) & 1;
+}
+
+static void span_mark(span_chunk_t* span_chunk, size_t first, size_t pages, uint8_t used) {
+    for (size_t page = first; page < first + pages; page++) {
+        if (used) span_chunk->used[page / 64] |= 1ull << (page % 64);
+        else span_chunk->used[page / 64] &= ~(1ull << (page % 64));
+    }
+}
+
+// Records pages as handed out, returns 1 if none of them ever were (still zero from mmap()).
+static uint8_t span_mark_dirty(span_chunk_t* span_chunk, size_t first, size_t pages) {
+    uint8_t clean = 1;
+    for (size_t page = first; page < first + pages; page++) {
+        uint64_t bit = 1ull << (page % 64);
+        if (span_chunk->dirty[page / 64] & bit) clean = 0;
+        span_chunk->dirty[page / 64] |= bit;
+    }
+    return clean;
+}
+
+// First-fit search for `pages` free pages starting on a multiple of align_pages, skips whole words at a time.
+// Returns 0 when nothing fits.
+static size_t span_find_run(const span_chunk_t* span_chunk, size_t pages, size_t align_pages) {
+    size_t run = 0;
+    size_t start = 0;
+    size_t page = span_chunk->first_page;
+
+    while (page < DAM_SPAN_CHUNK_PAGES) {
+        uint64_t word = span_chunk->used[page / 64];
+
+        if (page % 64 == 0 && word == UINT64_MAX) {
+            run = 0;
+            page += 64;
+            continue;
+        }
+
+        if (!run && page % align_pages) {
+            page = align_up(page, align_pages);
+            continue;
+        }
+
+        if (page % 64 == 0 && word == 0) {
+            if (!run) start = page;
+            run += 64;
+            page += 64;
+        } else if (span_page_used(span_chunk, page)) {
+            run = 0;
+            page++;
+        } else {
+            if (!run) start = page;
+            run++;
+            page++;
+        }
+
+        if (run >= pages) return start;
+    }
+
+    return 0;
+}
+
+static inline size_t span_pages_for(size_t size, uint8_t traced) {
+    return align_up(size + (traced ? TRACE_SIZE : 0), PAGE_SIZE) / PAGE_SIZE;
+}
+
+inline span_chunk_t* span_chunk_from_ptr(void* ptr) {
+    return (span_chunk_t*)((uintptr_t)ptr & ~(uintptr_t)(DAM_SPAN_CHUNK_SIZE - 1));
+}
+
+inline span_entry_t* get_span_entry(void* ptr, span_chunk_t* span_chunk) {
+    return &span_chunk->spans[((char*)ptr - (char*)span_chunk) / PAGE_SIZE];
+}
+
+// alignment of 0 means page aligned, bigger alignments are honoured up to DAM_SPAN_MAX.
+void* dam_span_malloc_internal(size_t size, const char* trace, size_t alignment) {
+    size_t pages = span_pages_for(size, trace != NULL);
+    size_t align_pages = alignment > PAGE_SIZE ? alignment / PAGE_SIZE : 1;
+
+    span_chunk_t* span_chunk = span_chunks;
+    size_t first = 0;
+    while (span_chunk) {
+        if (span_chunk->free_pages >= pages) {
+            first = span_find_run(span_chunk, pages, align_pages);
+            if (first) break;
+        }
+        span_chunk = span_chunk->next;
+    }
+
+    if (!span_chunk) {
+        span_chunk = create_span_chunk();
+        if (!span_chunk) return NULL;
+        first = span_find_run(span_chunk, pages, align_pages);
+    }
+
+    span_mark(span_chunk, first, pages, 1);
+    span_chunk->free_pages -= pages;
+
+    span_entry_t* span_entry = &span_chunk->spans[first];
+    span_entry->magic = BLOCK_MAGIC;
+    span_entry->pages = pages;
+    span_entry->user_size = size;
+    span_entry->is_free = 0;
+    span_entry->is_traced = 0;
+    span_entry->is_zero = span_mark_dirty(span_chunk, first, pages);
+
+    char* memory = (char*)span_chunk + first * PAGE_SIZE;
+
+    DAM_LOG("[SPAN] Allocated %zu pages at %p", pages, (void*)memory);
+
+    if (trace != NULL) {
+        span_entry->is_traced = 1;
+        strncpy(memory, trace, TRACE_SIZE - 1);
+        memory[TRACE_SIZE - 1] = '\0';
+
+        return memory + TRACE_SIZE;
+    }
+
+    return memory;
+}
+
+void dam_span_free_internal(void* ptr, pool_header_t* pool_header) {
+    span_chunk_t* span_chunk = (span_chunk_t*)pool_header;
+    span_entry_t* span_entry = get_span_entry(ptr, span_chunk);
+
+    // Double free checks
+    if (span_entry->magic == FREED_MAGIC) {
+        DAM_LOG_ERROR("[FREE] Double free detected at %p!", ptr);
+        return;
+    }
+
+    // Invalid pointer checks
+    if (span_entry->magic != BLOCK_MAGIC || (uintptr_t)ptr % PAGE_SIZE != (span_entry->is_traced ? TRACE_SIZE : 0)) {
+        DAM_LOG_ERROR("[FREE] Invalid pointer passed to dam_free: %p", ptr);
+        return;
+    }
+
+    size_t first = span_entry - span_chunk->spans;
+    span_mark(span_chunk, first, span_entry->pages, 0);
+    span_chunk->free_pages += span_entry->pages;
+
+    span_entry->magic = FREED_MAGIC;
+    span_entry->is_free = 1;
+
+    DAM_LOG("[FREE] Span %p freed (%u pages)", ptr, span_entry->pages);
+
+    // Keep one chunk around so a single churning buffer does not mmap() every time. Reserved chunks stay as well.
+    if (span_chunk->free_pages == DAM_SPAN_CHUNK_PAGES - span_chunk->first_page && !span_chunk->is_pinned
+        && (span_chunks != span_chunk || span_chunk->next)) {
+        release_span_chunk(span_chunk);
+    }
+}
+
+// Bytes usable at ptr, the size the span records and later reallocs preserve.
+size_t dam_span_usable_size(void* ptr, pool_header_t* pool_header) {
+    return get_span_entry(ptr, (span_chunk_t*)pool_header)->user_size;
+}
+
+// Records the capacity of a fresh span up to its last page as its size, so later reallocs preserve it.
+size_t dam_span_commit_usable(void* ptr, pool_header_t* pool_header) {
+    dam_span_lock();
+
+    span_entry_t* span_entry = get_span_entry(ptr, (span_chunk_t*)pool_header);
+    size_t usable_size = (size_t)span_entry->pages * PAGE_SIZE - (span_entry->is_traced ? TRACE_SIZE : 0);
+    span_entry->user_size = usable_size;
+
+    dam_span_unlock();
+    return usable_size;
+}
+
+/*
+ * Makes sure `bytes` of free pages exist in span chunks, creating chunks as needed. Chunks that count
+ * towards the reservation are pinned and never released, their free pages are prefaulted according to flags.
+ */
+uint8_t dam_span_reserve(size_t bytes, unsigned flags) {
+    dam_span_lock();
+
+    size_t wanted = align_up(bytes, PAGE_SIZE) / PAGE_SIZE;
+    size_t reserved = 0;
+    uint8_t result = 1;
+    span_chunk_t* span_chunk = span_chunks;
+
+    while (reserved < wanted) {
+        if (!span_chunk) {
+            span_chunk = create_span_chunk();
+            if (!span_chunk) {
+                result = 0;
+                break;
+            }
+        }
+
+        span_chunk->is_pinned = 1;
+
+        // Prefault free runs, stopping once enough pages are covered.
+        size_t page = span_chunk->first_page;
+        while (page < DAM_SPAN_CHUNK_PAGES && reserved < wanted) {
+            if (span_page_used(span_chunk, page)) {
+                page++;
+                continue;
+            }
+            size_t first = page;
+            while (page < DAM_SPAN_CHUNK_PAGES && !span_page_used(span_chunk, page) && reserved + (page - first) < wanted) page++;
+
+            if (!dam_prefault((char*)span_chunk + first * PAGE_SIZE, (page - first) * PAGE_SIZE, flags)) result = 0;
+            reserved += page - first;
+        }
+
+        span_chunk = span_chunk->next;
+    }
+
+    dam_span_unlock();
+    return result;
+}
+
+void* dam_span_malloc(size_t size, const char* trace) {
+    dam_span_lock();
+    void* ptr = dam_span_malloc_internal(size, trace, 0);
+    dam_span_unlock();
+
+    return ptr;
+}
+
+/*
+ * dam_mallocx() entry point. Honours DAM_MALLOCX_ALIGN, and DAM_MALLOCX_HUGE by aligning spans of at least
+ * one huge page to HUGE_PAGE_SIZE and advising the whole huge pages they cover.
+ */
+void* dam_span_mallocx(size_t size, int flags) {
+    size_t alignment = DAM_MALLOCX_ALIGNMENT(flags);
+    uint8_t huge = (flags & DAM_MALLOCX_HUGE) && size >= HUGE_PAGE_SIZE;
+    if (huge && alignment < HUGE_PAGE_SIZE) alignment = HUGE_PAGE_SIZE;
+
+    dam_span_lock();
+    void* ptr = dam_span_malloc_internal(size, NULL, alignment);
+    dam_span_unlock();
+
+    if (ptr && huge) dam_madvise_huge(ptr, size & ~(HUGE_PAGE_SIZE - 1));
+
+    return ptr;
+}
+
+void dam_span_free(void* ptr, pool_header_t* pool_header) {
+    dam_span_lock();
+    dam_span_free_internal(ptr, pool_header);
+    dam_span_unlock();
+}
+
+size_t dam_span_malloc_batch(size_t size, size_t count, void** out) {
+    size_t allocated = 0;
+
+    dam_span_lock();
+    while (allocated < count) {
+        void* ptr = dam_span_malloc_internal(size, NULL, 0);
+        if (!ptr) break;
+        out[allocated++] = ptr;
+    }
+    dam_span_unlock();
+
+    return allocated;
+}
+
+void dam_span_free_batch(void** ptrs, pool_header_t** pools, size_t count) {
+    dam_span_lock();
+    for (size_t i = 0; i < count; i++) {
+        dam_span_free_internal(ptrs[i], pools[i]);
+    }
+    dam_span_unlock();
+}
+
+void* dam_span_realloc(void* ptr, size_t size, pool_header_t* pool_header, const char* trace) {
+    span_chunk_t* span_chunk = (span_chunk_t*)pool_header;
+    span_entry_t* span_entry = get_span_entry(ptr, span_chunk);
+    size_t old_size = span_entry->user_size;
+
+    // Case 1 Cross to another layer
+    void* new_ptr;
+    if (size <= DAM_GENERAL_MAX || size > DAM_SPAN_MAX) {
+        new_ptr = dam_trace_malloc(size, trace);
+        if (new_ptr) {
+            dam_memcpy(new_ptr, ptr, old_size < size ? old_size : size);
+            dam_span_free(ptr, pool_header);
+        }
+        return new_ptr;
+    }
+
+    dam_span_lock();
+
+    if (span_entry->magic != BLOCK_MAGIC) {
+        DAM_LOG_ERROR("[REALLOC] Invalid pointer passed to dam_span_realloc: %p", ptr);
+        dam_span_unlock();
+        return NULL;
+    }
+
+    size_t first = span_entry - span_chunk->spans;
+    size_t pages = span_pages_for(size, span_entry->is_traced);
+
+    // Case 2 Shrink in place, trailing pages go back to the chunk
+    if (pages <= span_entry->pages) {
+        span_mark(span_chunk, first + pages, span_entry->pages - pages, 0);
+        span_chunk->free_pages += span_entry->pages - pages;
+        span_entry->pages = pages;
+        span_entry->user_size = size;
+
+        dam_span_unlock();
+        return ptr;
+    }
+
+    // Case 3 Grow in place if the following pages are free
+    size_t end = first + span_entry->pages;
+    size_t needed = pages - span_entry->pages;
+    if (first + pages <= DAM_SPAN_CHUNK_PAGES) {
+        size_t page = end;
+        while (page < first + pages && !span_page_used(span_chunk, page)) page++;
+
+        if (page == first + pages) {
+            span_mark(span_chunk, end, needed, 1);
+            span_mark_dirty(span_chunk, end, needed);
+            span_chunk->free_pages -= needed;
+            span_entry->pages = pages;
+            span_entry->user_size = size;
+
+            dam_span_unlock();
+            return ptr;
+        }
+    }
+
+    // Case 4 Move to a new span
+    new_ptr = dam_span_malloc_internal(size, trace, 0);
+    if (new_ptr) {
+        dam_memcpy(new_ptr, ptr, old_size);
+        dam_span_free_internal(ptr, pool_header);
+    }
+
+    dam_span_unlock();
+    return new_ptr;
+}
+
+void dam_snapshot_span(dam_snapshot_t* snapshot) {
+    dam_span_lock();
+    span_chunk_t* current = span_chunks;
+    while (current) {
+        snapshot->span_chunks++;
+        snapshot->span_bytes_mapped += DAM_SPAN_CHUNK_SIZE;
+        if (current->pool.is_huge) snapshot->huge_page_bytes += DAM_SPAN_CHUNK_SIZE;
+        snapshot->span_bytes_used += (DAM_SPAN_CHUNK_PAGES - current->first_page - current->free_pages) * PAGE_SIZE;
+        current = current->next;
+    }
+    dam_span_unlock();
+}
+
+uint8_t dam_validate_span_ptr(void* ptr, pool_header_t* pool_header) {
+    span_chunk_t* span_chunk = (span_chunk_t*)pool_header;
+    size_t page = ((char*)ptr - (char*)span_chunk) / PAGE_SIZE;
+
+    if (page < span_chunk->first_page) {
+        DAM_LOG_VALID_ERROR("Pointer points into span chunk metadata: %p", ptr);
+        return 0;
+    }
+
+    const span_entry_t* span_entry = &span_chunk->spans[page];
+
+    if (!span_entry->is_free) {
+        if (span_entry->magic != BLOCK_MAGIC) {
+            DAM_LOG_VALID_ERROR("Pointer span magic does not match: %p, magic %d", ptr, span_entry->magic);
+            return 0;
+        }
+
+        if (!span_page_used(span_chunk, page) || !span_page_used(span_chunk, page + span_entry->pages - 1)) {
+            DAM_LOG_VALID_ERROR("Pointer span pages are not marked as used: %p", ptr);
+            return 0;
+        }
+    } else {
+        DAM_LOG("Pointer span is free: %p", ptr);
+        if (span_entry->magic != FREED_MAGIC) {
+            DAM_LOG_VALID_ERROR("Pointer span free magic does not match: %p, magic %d", ptr, span_entry->magic);
+            return 0;
+        }
+    }
+
+    return 1;
+}
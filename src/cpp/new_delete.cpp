@@ -0,0 +1,81 @@
+#include <cstddef>
+#include <new>
+
+#include "dam/dam.h"
+
+/**********************************************************
+ * Global operator new / delete replacement
+ *
+ * operator new            ← dam_malloc(), dam_aligned_alloc() for align_val_t
+ * operator delete         ← dam_free()
+ * └─ sized                ← dam_free_sized(), skips the pool lookup
+ *
+ * Optional, link the dam_new_delete target to route every C++
+ * allocation of the program through DAM. Aligned allocations may sit
+ * in a bigger layer than their size, so they are never freed sized.
+ **********************************************************/
+
+namespace {
+    // Retries through the new handler like the standard operator new, throws std::bad_alloc without one.
+    void* dam_new(size_t size, size_t alignment) {
+        if (size == 0) size = 1;
+
+        for (;;) {
+            void* ptr = alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__ ? dam_aligned_alloc(alignment, size) : dam_malloc(size);
+            if (ptr) return ptr;
+
+            std::new_handler handler = std::get_new_handler();
+            if (!handler) throw std::bad_alloc();
+            handler();
+        }
+    }
+
+    void* dam_new_nothrow(size_t size, size_t alignment) noexcept {
+        try {
+            return dam_new(size, alignment);
+        } catch (...) {
+            return nullptr;
+        }
+    }
+
+    void dam_delete_sized(void* ptr, size_t size) noexcept {
+        if (ptr) dam_free_sized(ptr, size ? size : 1);
+    }
+}
+
+/*********************
+ * operator new      *
+ *********************/
+
+void* operator new(size_t size) { return dam_new(size, 0); }
+void* operator new[](size_t size) { return dam_new(size, 0); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return dam_new_nothrow(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return dam_new_nothrow(size, 0); }
+
+void* operator new(size_t size, std::align_val_t alignment) { return dam_new(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, std::align_val_t alignment) { return dam_new(size, static_cast<size_t>(alignment)); }
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return dam_new_nothrow(size, static_cast<size_t>(alignment));
+}
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return dam_new_nothrow(size, static_cast<size_t>(alignment));
+}
+
+/*********************
+ * operator delete   *
+ *********************/
+
+void operator delete(void* ptr) noexcept { dam_free(ptr); }
+void operator delete[](void* ptr) noexcept { dam_free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { dam_free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { dam_free(ptr); }
+
+void operator delete(void* ptr, size_t size) noexcept { dam_delete_sized(ptr, size); }
+void operator delete[](void* ptr, size_t size) noexcept { dam_delete_sized(ptr, size); }
+
+void operator delete(void* ptr, std::align_val_t) noexcept { dam_free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { dam_free(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { dam_free(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { dam_free(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { dam_free(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { dam_free(ptr); }
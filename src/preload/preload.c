@@ -0,0 +1,214 @@
+#define _GNU_SOURCE // RTLD_NEXT
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "dam/dam.h"
+#include "dam/dam_config.h"
+#include "dam/dam_log.h"
+#include "dam/internal/dam_internal.h"
+
+/**********************************************************
+ * LD_PRELOAD interposition (libdam_preload.so)
+ *
+ * malloc() & co.          ← exported, forwarded to the dam_*() API
+ * ├─ bootstrap buffer     ← static bump buffer, never freed
+ * └─ libc allocator       ← dlsym(RTLD_NEXT), owns foreign pointers
+ *
+ * dam_init(), dlsym() and DAM_LOG may allocate themselves, calls that
+ * come back in on the initializing thread are served from the
+ * bootstrap buffer. Pointers DAM does not own are handed back to the
+ * libc allocator instead of being logged and dropped.
+ *
+ * LD_PRELOAD=./libdam_preload.so ./program
+ **********************************************************/
+
+#define BOOTSTRAP_ALIGNMENT PAGE_SIZE
+
+static char bootstrap_buffer[DAM_PRELOAD_BOOTSTRAP_SIZE] __attribute__((aligned(BOOTSTRAP_ALIGNMENT)));
+static size_t bootstrap_used = 0;
+
+static int preload_ready = 0;
+static pthread_mutex_t preload_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread int preload_initializing __attribute__((tls_model("initial-exec"))) = 0;
+
+static void (*libc_free)(void*) = NULL;
+static void* (*libc_realloc)(void*, size_t) = NULL;
+static size_t (*libc_malloc_usable_size)(void*) = NULL;
+
+// Bump allocation with the size stored in front. The buffer starts zeroed and is never reused, so it is calloc() safe.
+static void* bootstrap_alloc(size_t size, size_t alignment) {
+    if (alignment < ALIGNMENT) alignment = ALIGNMENT;
+    if (alignment > BOOTSTRAP_ALIGNMENT) return NULL;
+
+    size_t used = __atomic_load_n(&bootstrap_used, __ATOMIC_RELAXED);
+    size_t start, end;
+    do {
+        start = align_up(used + sizeof(size_t), alignment);
+        end = start + size;
+        if (end < start || end > DAM_PRELOAD_BOOTSTRAP_SIZE) {
+            errno = ENOMEM;
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&bootstrap_used, &used, end, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    char* ptr = bootstrap_buffer + start;
+    ((size_t*)ptr)[-1] = size;
+    return ptr;
+}
+
+static inline uint8_t is_bootstrap(const void* ptr) {
+    return (const char*)ptr >= bootstrap_buffer && (const char*)ptr < bootstrap_buffer + DAM_PRELOAD_BOOTSTRAP_SIZE;
+}
+
+static inline size_t bootstrap_size(const void* ptr) {
+    return ((const size_t*)ptr)[-1];
+}
+
+// A fork() while another thread holds a layer lock would leave it locked in the child forever.
+static void preload_prefork(void) {
+    dam_small_lock();
+    dam_general_lock();
+    dam_span_lock();
+    dam_direct_lock();
+}
+
+static void preload_postfork(void) {
+    dam_direct_unlock();
+    dam_span_unlock();
+    dam_general_unlock();
+    dam_small_unlock();
+}
+
+// Returns 1 once DAM serves allocations, 0 for calls made while this thread initializes it.
+static int preload_init(void) {
+    if (__builtin_expect(__atomic_load_n(&preload_ready, __ATOMIC_ACQUIRE), 1)) return 1;
+    if (preload_initializing) return 0;
+
+    preload_initializing = 1;
+    pthread_mutex_lock(&preload_lock);
+
+    if (!preload_ready && dam_init() == 0) {
+        libc_free = (void (*)(void*))dlsym(RTLD_NEXT, "free");
+        libc_realloc = (void* (*)(void*, size_t))dlsym(RTLD_NEXT, "realloc");
+        libc_malloc_usable_size = (size_t (*)(void*))dlsym(RTLD_NEXT, "malloc_usable_size");
+        pthread_atfork(preload_prefork, preload_postfork, preload_postfork);
+
+        __atomic_store_n(&preload_ready, 1, __ATOMIC_RELEASE);
+    }
+
+    pthread_mutex_unlock(&preload_lock);
+    preload_initializing = 0;
+
+    return preload_ready;
+}
+
+static inline void* preload_result(void* ptr) {
+    if (!ptr) errno = ENOMEM;
+    return ptr;
+}
+
+/*********************
+ * Exported API      *
+ *********************/
+
+// malloc(0) returns a unique pointer like glibc does, dam_malloc(0) returns NULL.
+void* malloc(size_t size) {
+    if (!preload_init()) return bootstrap_alloc(size, ALIGNMENT);
+    return preload_result(dam_malloc(size ? size : 1));
+}
+
+void free(void* ptr) {
+    if (!ptr || is_bootstrap(ptr)) return;
+
+    if (preload_init() && dam_try_free(ptr)) return;
+    if (libc_free) libc_free(ptr);
+}
+
+void* calloc(size_t nmemb, size_t size) {
+    size_t total;
+    if (__builtin_mul_overflow(nmemb, size, &total)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if (!preload_init()) return bootstrap_alloc(total, ALIGNMENT);
+    return preload_result(dam_calloc(total ? total : 1, 1));
+}
+
+// Bootstrap blocks move into DAM, foreign pointers stay with the allocator that made them.
+void* realloc(void* ptr, size_t size) {
+    if (!ptr) return malloc(size);
+
+    if (is_bootstrap(ptr)) {
+        if (size == 0) return NULL;
+
+        void* new_ptr = malloc(size);
+        if (new_ptr) memcpy(new_ptr, ptr, bootstrap_size(ptr) < size ? bootstrap_size(ptr) : size);
+        return new_ptr;
+    }
+
+    if (!preload_init() || !dam_pool_from_ptr(ptr)) {
+        if (libc_realloc) return libc_realloc(ptr, size);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    if (size == 0) {
+        dam_free(ptr);
+        return NULL;
+    }
+    return preload_result(dam_realloc(ptr, size));
+}
+
+void* reallocarray(void* ptr, size_t nmemb, size_t size) {
+    size_t total;
+    if (__builtin_mul_overflow(nmemb, size, &total)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return realloc(ptr, total);
+}
+
+int posix_memalign(void** memptr, size_t alignment, size_t size) {
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) return EINVAL;
+
+    void* ptr = preload_init() ? dam_mallocx(size ? size : 1, DAM_MALLOCX_ALIGN(alignment)) : bootstrap_alloc(size, alignment);
+    if (!ptr) return ENOMEM;
+
+    *memptr = ptr;
+    return 0;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (!preload_init()) return bootstrap_alloc(size, alignment);
+    return preload_result(dam_aligned_alloc(alignment, size ? size : 1));
+}
+
+void* memalign(size_t alignment, size_t size) {
+    return aligned_alloc(alignment, size);
+}
+
+void* valloc(size_t size) {
+    return aligned_alloc(PAGE_SIZE, size);
+}
+
+void* pvalloc(size_t size) {
+    return aligned_alloc(PAGE_SIZE, align_up(size ? size : 1, PAGE_SIZE));
+}
+
+size_t malloc_usable_size(void* ptr) {
+    if (!ptr) return 0;
+    if (is_bootstrap(ptr)) return bootstrap_size(ptr);
+
+    if (preload_init() && dam_pool_from_ptr(ptr)) return dam_usable_size(ptr);
+    return libc_malloc_usable_size ? libc_malloc_usable_size(ptr) : 0;
+}
@@ -0,0 +1,237 @@
+#define _GNU_SOURCE // _SC_LEVEL3_CACHE_SIZE
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dam/dam_config.h"
+#include "dam/dam_log.h"
+#include "dam/internal/dam_internal.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define DAM_MEMORY_X86 1
+#else
+#define DAM_MEMORY_X86 0
+#endif
+
+/**********************************************************
+ * Copy & zero kernels
+ *
+ * dam_memcpy() / dam_memzero()
+ * ├─ libc                       ← below streaming_threshold
+ * └─ copy_kernel / zero_kernel  ← picked once by dam_memory_init()
+ *     ├─ AVX-512
+ *     ├─ AVX2
+ *     ├─ SSE2
+ *     └─ libc
+ *
+ * Sizes of at least streaming_threshold use non-temporal stores,
+ * so big cross layer copies do not evict the working set. Below it
+ * libc is at least as fast as the hand unrolled loops.
+ **********************************************************/
+
+typedef void (*copy_kernel_t)(void* dst, const void* src, size_t size);
+typedef void (*zero_kernel_t)(void* dst, size_t size);
+
+static void copy_libc(void* dst, const void* src, size_t size) {
+    memcpy(dst, src, size);
+}
+
+static void zero_libc(void* dst, size_t size) {
+    memset(dst, 0, size);
+}
+
+static copy_kernel_t copy_kernel = copy_libc;
+static zero_kernel_t zero_kernel = zero_libc;
+static size_t streaming_threshold = SIZE_MAX;
+
+#if DAM_MEMORY_X86
+
+/*
+ * Every kernel aligns the destination to its vector width with a libc head copy, runs the
+ * streaming loop, fences it and leaves the tail to libc again.
+ */
+
+__attribute__((target("sse2")))
+static void copy_sse2(void* dst, const void* src, size_t size) {
+    char* d = dst;
+    const char* s = src;
+
+    size_t head = (0 - (uintptr_t)d) & 15;
+    if (head > size) head = size;
+    memcpy(d, s, head);
+    d += head; s += head; size -= head;
+
+    for (; size >= 64; d += 64, s += 64, size -= 64) {
+        __m128i a = _mm_loadu_si128((const __m128i*)s);
+        __m128i b = _mm_loadu_si128((const __m128i*)(s + 16));
+        __m128i c = _mm_loadu_si128((const __m128i*)(s + 32));
+        __m128i e = _mm_loadu_si128((const __m128i*)(s + 48));
+        _mm_stream_si128((__m128i*)d, a);
+        _mm_stream_si128((__m128i*)(d + 16), b);
+        _mm_stream_si128((__m128i*)(d + 32), c);
+        _mm_stream_si128((__m128i*)(d + 48), e);
+    }
+    _mm_sfence();
+
+    memcpy(d, s, size);
+}
+
+__attribute__((target("sse2")))
+static void zero_sse2(void* dst, size_t size) {
+    char* d = dst;
+    const __m128i zero = _mm_setzero_si128();
+
+    size_t head = (0 - (uintptr_t)d) & 15;
+    if (head > size) head = size;
+    memset(d, 0, head);
+    d += head; size -= head;
+
+    for (; size >= 64; d += 64, size -= 64) {
+        _mm_stream_si128((__m128i*)d, zero);
+        _mm_stream_si128((__m128i*)(d + 16), zero);
+        _mm_stream_si128((__m128i*)(d + 32), zero);
+        _mm_stream_si128((__m128i*)(d + 48), zero);
+    }
+    _mm_sfence();
+
+    memset(d, 0, size);
+}
+
+__attribute__((target("avx2")))
+static void copy_avx2(void* dst, const void* src, size_t size) {
+    char* d = dst;
+    const char* s = src;
+
+    size_t head = (0 - (uintptr_t)d) & 31;
+    if (head > size) head = size;
+    memcpy(d, s, head);
+    d += head; s += head; size -= head;
+
+    for (; size >= 128; d += 128, s += 128, size -= 128) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)s);
+        __m256i b = _mm256_loadu_si256((const __m256i*)(s + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(s + 64));
+        __m256i e = _mm256_loadu_si256((const __m256i*)(s + 96));
+        _mm256_stream_si256((__m256i*)d, a);
+        _mm256_stream_si256((__m256i*)(d + 32), b);
+        _mm256_stream_si256((__m256i*)(d + 64), c);
+        _mm256_stream_si256((__m256i*)(d + 96), e);
+    }
+    _mm_sfence();
+    _mm256_zeroupper();
+
+    memcpy(d, s, size);
+}
+
+__attribute__((target("avx2")))
+static void zero_avx2(void* dst, size_t size) {
+    char* d = dst;
+    const __m256i zero = _mm256_setzero_si256();
+
+    size_t head = (0 - (uintptr_t)d) & 31;
+    if (head > size) head = size;
+    memset(d, 0, head);
+    d += head; size -= head;
+
+    for (; size >= 128; d += 128, size -= 128) {
+        _mm256_stream_si256((__m256i*)d, zero);
+        _mm256_stream_si256((__m256i*)(d + 32), zero);
+        _mm256_stream_si256((__m256i*)(d + 64), zero);
+        _mm256_stream_si256((__m256i*)(d + 96), zero);
+    }
+    _mm_sfence();
+    _mm256_zeroupper();
+
+    memset(d, 0, size);
+}
+
+__attribute__((target("avx512f")))
+static void copy_avx512(void* dst, const void* src, size_t size) {
+    char* d = dst;
+    const char* s = src;
+
+    size_t head = (0 - (uintptr_t)d) & 63;
+    if (head > size) head = size;
+    memcpy(d, s, head);
+    d += head; s += head; size -= head;
+
+    for (; size >= 256; d += 256, s += 256, size -= 256) {
+        __m512i a = _mm512_loadu_si512((const void*)s);
+        __m512i b = _mm512_loadu_si512((const void*)(s + 64));
+        __m512i c = _mm512_loadu_si512((const void*)(s + 128));
+        __m512i e = _mm512_loadu_si512((const void*)(s + 192));
+        _mm512_stream_si512((void*)d, a);
+        _mm512_stream_si512((void*)(d + 64), b);
+        _mm512_stream_si512((void*)(d + 128), c);
+        _mm512_stream_si512((void*)(d + 192), e);
+    }
+    _mm_sfence();
+    _mm256_zeroupper();
+
+    memcpy(d, s, size);
+}
+
+__attribute__((target("avx512f")))
+static void zero_avx512(void* dst, size_t size) {
+    char* d = dst;
+    const __m512i zero = _mm512_setzero_si512();
+
+    size_t head = (0 - (uintptr_t)d) & 63;
+    if (head > size) head = size;
+    memset(d, 0, head);
+    d += head; size -= head;
+
+    for (; size >= 256; d += 256, size -= 256) {
+        _mm512_stream_si512((void*)d, zero);
+        _mm512_stream_si512((void*)(d + 64), zero);
+        _mm512_stream_si512((void*)(d + 128), zero);
+        _mm512_stream_si512((void*)(d + 192), zero);
+    }
+    _mm_sfence();
+    _mm256_zeroupper();
+
+    memset(d, 0, size);
+}
+
+#endif
+
+// Picks the widest kernels the CPU supports and the streaming threshold. Called from dam_init().
+void dam_memory_init(void) {
+#if DAM_MEMORY_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f")) {
+        copy_kernel = copy_avx512;
+        zero_kernel = zero_avx512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        copy_kernel = copy_avx2;
+        zero_kernel = zero_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        copy_kernel = copy_sse2;
+        zero_kernel = zero_sse2;
+    }
+#endif
+
+    streaming_threshold = DAM_STREAMING_THRESHOLD;
+    if (!streaming_threshold) {
+        long llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+        if (llc <= 0) llc = sysconf(_SC_LEVEL2_CACHE_SIZE);
+        streaming_threshold = llc > 0 ? (size_t)llc : DAM_STREAMING_FALLBACK;
+    }
+
+    DAM_LOG("[INIT] Memory kernels initialized, streaming from %zu bytes", streaming_threshold);
+}
+
+void* dam_memcpy(void* dst, const void* src, size_t size) {
+    if (size < streaming_threshold) return memcpy(dst, src, size);
+    copy_kernel(dst, src, size);
+    return dst;
+}
+
+void* dam_memzero(void* dst, size_t size) {
+    if (size < streaming_threshold) return memset(dst, 0, size);
+    zero_kernel(dst, size);
+    return dst;
+}
@@ -10,7 +10,9 @@
 
 static pthread_mutex_t small_lock;
 static pthread_mutex_t general_lock;
+static pthread_mutex_t span_lock;
 static pthread_mutex_t direct_lock;
+static pthread_rwlock_t pool_list_lock = PTHREAD_RWLOCK_INITIALIZER; // Lookups may run before dam_init()
 
 static int dam_lock_initialized = 0;
 
@@ -19,13 +21,12 @@ static __thread thread_cache_t* thread_cache = NULL;
 static pthread_key_t dam_thread_cache_key;
 static pthread_once_t dam_thread_key_once = PTHREAD_ONCE_INIT;
 
-extern void dam_small_free_to_central(void* ptr);
-
 void dam_thread_init(void) {
     if (dam_lock_initialized) return;
 
     pthread_mutex_init(&small_lock, NULL);
     pthread_mutex_init(&general_lock, NULL);
+    pthread_mutex_init(&span_lock, NULL);
     pthread_mutex_init(&direct_lock, NULL);
     dam_lock_initialized = 1;
 }
@@ -36,9 +37,17 @@ inline void dam_small_unlock(void) { pthread_mutex_unlock(&small_lock); }
 inline void dam_general_lock(void) { pthread_mutex_lock(&general_lock); }
 inline void dam_general_unlock(void) { pthread_mutex_unlock(&general_lock); }
 
+inline void dam_span_lock(void) { pthread_mutex_lock(&span_lock); }
+inline void dam_span_unlock(void) { pthread_mutex_unlock(&span_lock); }
+
 inline void dam_direct_lock(void) { pthread_mutex_lock(&direct_lock); }
 inline void dam_direct_unlock(void) { pthread_mutex_unlock(&direct_lock); }
 
+// Innermost lock, nothing else is taken while holding it.
+inline void dam_pool_list_read_lock(void) { pthread_rwlock_rdlock(&pool_list_lock); }
+inline void dam_pool_list_write_lock(void) { pthread_rwlock_wrlock(&pool_list_lock); }
+inline void dam_pool_list_unlock(void) { pthread_rwlock_unlock(&pool_list_lock); }
+
 static void thread_cache_destructor(void* cache_ptr) {
     if (!cache_ptr) return;
     thread_cache_t* tc = cache_ptr;
@@ -46,16 +55,10 @@ static void thread_cache_destructor(void* cache_ptr) {
     DAM_LOG("[TCACHE] Thread %lu exiting, flushing %lu allocations back to central",
         pthread_self(), tc->allocations);
 
-    for (size_t class_idx = 0; class_idx < DAM_SIZE_CLASS_COUNT; class_idx++) {
-        size_class_header_t* block = tc->tc_bins[class_idx].free_list;
-
-        while (block) {
-            size_class_header_t* next = block->next;
-            dam_small_free_to_central((char*)block + SIZE_CLASS_HEADER_SIZE);
-            block = next;
-        }
-    }
+    dam_small_flush_thread_cache(tc);
 
+    // Runs on the exiting thread, a later allocation from another key destructor maps a fresh cache.
+    if (tc == thread_cache) thread_cache = NULL;
     munmap(tc, sizeof(thread_cache_t));
 }
 
@@ -89,6 +92,7 @@ thread_cache_t* dam_get_thread_cache(void) {
         return NULL;
     }
 
+    pthread_once(&dam_thread_key_once, make_thread_cache_key);
     pthread_setspecific(dam_thread_cache_key, thread_cache);
 
     DAM_LOG("[TCACHE] Initialized cache for thread %lu", pthread_self());
@@ -102,6 +106,7 @@ inline thread_cache_t* dam_get_current_thread_cache(void) {
 
 void dam_thread_cache_destroy(void) {
     if (thread_cache) {
+        pthread_setspecific(dam_thread_cache_key, NULL);
         thread_cache_destructor(thread_cache);
         thread_cache = NULL;
     }
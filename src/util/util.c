@@ -1,4 +1,9 @@
+#define _GNU_SOURCE // MAP_HUGETLB
+
 #include <assert.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "dam/dam_config.h"
@@ -6,6 +11,9 @@
 #include "dam/internal/dam_internal.h"
 
 typedef struct pool_header pool_header_t;
+
+static unsigned huge_page_policy = DAM_HUGE_PAGE_POLICY;
+
 /*********************
  * Helper Functions *
  *********************/
@@ -25,31 +33,189 @@ int verify_page_size(void) {
     return 1;
 }
 
+/*
+ * mmap()'s `size` bytes aligned to `alignment` (a power of two, multiple of PAGE_SIZE)
+ * by over-mapping and trimming both ends. Returns NULL on failure.
+ */
+void* dam_map_aligned(size_t size, size_t alignment) {
+    size_t padded = size + alignment - PAGE_SIZE;
+
+    char* memory = mmap(
+        NULL,
+        padded,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,
+        0
+    );
+
+    if (memory == MAP_FAILED) return NULL;
+
+    char* aligned = (char*)align_up((uintptr_t)memory, alignment);
+    size_t head = aligned - memory;
+    size_t tail = padded - head - size;
+
+    if (head) munmap(memory, head);
+    if (tail) munmap(aligned + size, tail);
+
+    return aligned;
+}
+
+// Takes effect for pools and mappings created from now on, existing memory is left alone.
+void dam_set_huge_page_policy(unsigned policy) {
+    huge_page_policy = policy;
+}
+
+unsigned dam_get_huge_page_policy(void) {
+    return huge_page_policy;
+}
+
+inline uint8_t dam_huge_page_policy_has(unsigned flag) {
+    return (huge_page_policy & flag) != 0;
+}
+
+/*
+ * Asks the kernel to back a region with transparent huge pages. Only whole, aligned huge pages can be
+ * promoted, so smaller or misaligned regions are skipped. Returns a DAM_HUGE_BACKING_* value.
+ */
+uint8_t dam_advise_huge(void* memory, size_t size) {
+    if (!dam_huge_page_policy_has(DAM_HUGE_PAGE_MADVISE)) return DAM_HUGE_BACKING_NONE;
+    return dam_madvise_huge(memory, size);
+}
+
+// Same as dam_advise_huge() but ignores the policy, for explicit per allocation requests.
+uint8_t dam_madvise_huge(void* memory, size_t size) {
+    if (size < HUGE_PAGE_SIZE || (uintptr_t)memory % HUGE_PAGE_SIZE != 0) return DAM_HUGE_BACKING_NONE;
+
+#ifdef MADV_HUGEPAGE
+    if (madvise(memory, size, MADV_HUGEPAGE) == 0) return DAM_HUGE_BACKING_THP;
+    DAM_LOG("[HUGE] madvise(MADV_HUGEPAGE) refused for %p", memory);
+#endif
+    return DAM_HUGE_BACKING_NONE;
+}
+
+/*
+ * mmap()'s a pool. Under DAM_HUGE_PAGE_MADVISE, pools of at least one huge page are
+ * aligned to HUGE_PAGE_SIZE and advised. Returns NULL on failure.
+ */
+void* dam_map_pool(size_t size, uint8_t* is_huge) {
+    void* memory;
+    if (dam_huge_page_policy_has(DAM_HUGE_PAGE_MADVISE) && size >= HUGE_PAGE_SIZE) {
+        memory = dam_map_aligned(align_up(size, PAGE_SIZE), HUGE_PAGE_SIZE);
+    } else {
+        memory = mmap(
+            NULL,
+            size,
+            PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS,
+            -1,
+            0
+        );
+        if (memory == MAP_FAILED) memory = NULL;
+    }
+
+    *is_huge = memory ? dam_advise_huge(memory, size) : DAM_HUGE_BACKING_NONE;
+    return memory;
+}
+
+// MAP_HUGETLB mapping of `size` (a multiple of HUGE_PAGE_SIZE). Returns NULL when no huge pages are reserved.
+void* dam_map_hugetlb(size_t size) {
+#ifdef MAP_HUGETLB
+    void* memory = mmap(
+        NULL,
+        size,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,
+        -1,
+        0
+    );
+
+    if (memory != MAP_FAILED) return memory;
+    DAM_LOG("[HUGE] MAP_HUGETLB failed for %zu bytes, falling back to regular pages", size);
+#endif
+    return NULL;
+}
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23 // Linux 5.14, missing from older headers
+#endif
+
+/*
+ * Faults in and optionally locks a region so later accesses never trap into the kernel.
+ * Pages are only faulted in with MADV_POPULATE_WRITE, never by touching them, a touch could
+ * race with another thread writing to a live block on the same page. Returns 0 if any step failed.
+ */
+uint8_t dam_prefault(void* memory, size_t size, unsigned flags) {
+    uint8_t result = 1;
+    char* start = (char*)((uintptr_t)memory & ~(uintptr_t)(PAGE_SIZE - 1));
+    size = align_up((char*)memory + size - start, PAGE_SIZE);
+
+    if (flags & DAM_RESERVE_WILLNEED) {
+        if (madvise(start, size, MADV_WILLNEED) != 0) result = 0;
+    }
+
+    if (flags & DAM_RESERVE_POPULATE) {
+        if (madvise(start, size, MADV_POPULATE_WRITE) != 0) {
+            DAM_LOG_ERROR("[RESERVE] MADV_POPULATE_WRITE failed for %zu bytes at %p", size, (void*)start);
+            result = 0;
+        }
+    }
+
+    if (flags & DAM_RESERVE_LOCK) {
+        if (mlock(start, size) != 0) {
+            DAM_LOG_ERROR("[RESERVE] mlock failed for %zu bytes at %p", size, (void*)start);
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+// Monotonic milliseconds, only used for relative ages.
+uint64_t dam_now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/*
+ * dam_pool_list is shared by every layer and walked by every thread, including the deferred free reclaimer,
+ * so changes and walks go through the pool list lock.
+ */
 void dam_register_pool(pool_header_t *new_pool_header) {
+    dam_pool_list_write_lock();
     new_pool_header->next = dam_pool_list;
     dam_pool_list = new_pool_header;
+    dam_pool_list_unlock();
 }
 
 void dam_unregister_pool(pool_header_t *pool_header) {
+    dam_pool_list_write_lock();
     pool_header_t **current = &dam_pool_list;
 
     while (*current) {
         if (*current == pool_header) {
             *current = pool_header->next;
-            return;
+            break;
         }
         current = &(*current)->next;
     }
+    dam_pool_list_unlock();
+}
+
+inline uint8_t dam_pool_contains(const pool_header_t* pool_header, const void* ptr) {
+    return ptr >= pool_header->memory && (const char*)ptr < (const char*)pool_header->memory + pool_header->size;
 }
 
+// The pool of a live allocation stays registered, so it can be used after the lock is dropped.
 pool_header_t *dam_pool_from_ptr(void *ptr) {
+    dam_pool_list_read_lock();
     pool_header_t *pool_header = dam_pool_list;
 
     while (pool_header) {
-        if (ptr >= pool_header->memory && (char *) ptr < (char *) pool_header->memory + pool_header->size) {
-            return pool_header;
-        }
+        if (dam_pool_contains(pool_header, ptr)) break;
         pool_header = pool_header->next;
     }
-    return NULL;
+    dam_pool_list_unlock();
+    return pool_header;
 }
@@ -7,6 +7,9 @@
  *        and sequential sweep patterns.
  */
 
+#include <errno.h>
+#include <pthread.h>
+#include <sys/wait.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
@@ -130,9 +133,15 @@ void print_snapshot(const dam_snapshot_t* snapshot) {
     printf("pools_active: %zu\n", snapshot->pools_active);
     printf("pools_bytes_used: %zu\n", snapshot->pools_bytes_used);
     printf("quarantined_pools: %zu\n", snapshot->quarantined_pools);
+    printf("span_chunks: %zu\n", snapshot->span_chunks);
+    printf("span_bytes_mapped: %zu\n", snapshot->span_bytes_mapped);
+    printf("span_bytes_used: %zu\n", snapshot->span_bytes_used);
     printf("direct_allocations: %zu\n", snapshot->direct_allocations);
     printf("direct_bytes_used: %zu\n", snapshot->direct_bytes_used);
-    printf("Grand total used: %zu Kilobytes \n", (snapshot->classes_bytes_used + snapshot->pools_bytes_used + snapshot->direct_bytes_used) / 1024);
+    printf("direct_cached_mappings: %zu\n", snapshot->direct_cached_mappings);
+    printf("direct_cached_bytes: %zu\n", snapshot->direct_cached_bytes);
+    printf("huge_page_bytes: %zu\n", snapshot->huge_page_bytes);
+    printf("Grand total used: %zu Kilobytes \n", (snapshot->classes_bytes_used + snapshot->pools_bytes_used + snapshot->span_bytes_mapped + snapshot->direct_bytes_used) / 1024);
 }
 
 /* ------------------------------------------------------------------ */
@@ -430,6 +439,1015 @@ static void test_big_direct_allocations(void) {
     printf("  PASS\n\n");
 }
 
+static void test_direct_cache(void) {
+    printf("=== Test 9: Direct mapping cache ===\n");
+    dam_direct_cache_configure(MiB(128), MiB(48), 60000);
+
+    void* a = dam_malloc(MiB(40));
+    memset(a, 0xAB, MiB(40));
+    dam_free(a);
+
+    dam_snapshot_t snapshot = {0};
+    dam_snapshot(&snapshot);
+    if (snapshot.direct_cached_mappings < 1) {
+        fprintf(stderr, "[FAIL] Freed mapping was not cached\n"); abort();
+    }
+
+    void* b = dam_malloc(MiB(38));
+    if (b != a) {
+        fprintf(stderr, "[FAIL] Cached mapping was not reused\n"); abort();
+    }
+    memset(b, 0xCD, MiB(38));
+    dam_free(b);
+
+    // Too big for a cache entry, must be unmapped straight away.
+    void* c = dam_malloc(MiB(64));
+    dam_free(c);
+
+    dam_direct_cache_flush();
+    memset(&snapshot, 0, sizeof(snapshot));
+    dam_snapshot(&snapshot);
+    if (snapshot.direct_cached_mappings != 0 || snapshot.direct_cached_bytes != 0) {
+        fprintf(stderr, "[FAIL] Cache not empty after flush\n"); abort();
+    }
+
+    dam_direct_cache_configure(DAM_DIRECT_CACHE_MAX_BYTES, DAM_DIRECT_CACHE_MAX_ENTRY_SIZE, DAM_DIRECT_CACHE_MAX_AGE_MS);
+    printf("  PASS\n\n");
+}
+
+static void test_direct_remap(void) {
+    printf("=== Test 10: Direct realloc through mremap ===\n");
+    size_t size = DAM_SPAN_MAX + 100;
+    uint8_t* a = dam_malloc(size);
+    fill_magic(a, size, 0xC0FFEE11);
+
+    // Still inside the last mapped page.
+    uint8_t* b = dam_realloc(a, size + 64);
+    if (b != a || !verify_magic(b, size, 0xC0FFEE11)) {
+        fprintf(stderr, "[FAIL] Growth inside page slack moved or lost data\n"); abort();
+    }
+
+    size_t grown = MiB(96);
+    uint8_t* c = dam_realloc(b, grown);
+    if (!c || !verify_magic(c, size, 0xC0FFEE11)) {
+        fprintf(stderr, "[FAIL] Data not preserved through mremap growth\n"); abort();
+    }
+    fill_magic(c, grown, 0x5EED5EED);
+
+    uint8_t* d = dam_realloc(c, MiB(40));
+    if (d != c || !verify_magic(d, MiB(40), 0x5EED5EED)) {
+        fprintf(stderr, "[FAIL] Data not preserved through mremap shrink\n"); abort();
+    }
+    if (!dam_validate_ptr(d, 0, 0)) {
+        fprintf(stderr, "[FAIL] Remapped pointer no longer validates\n"); abort();
+    }
+
+    // Sizes that wrap when rounded to pages fail and leave the mapping alone.
+    if (dam_realloc(d, SIZE_MAX) || dam_realloc(d, SIZE_MAX - PAGE_SIZE) || dam_malloc(SIZE_MAX)) {
+        fprintf(stderr, "[FAIL] Overflowing direct size succeeded\n"); abort();
+    }
+    if (dam_usable_size(d) != MiB(40) || !verify_magic(d, MiB(40), 0x5EED5EED)) {
+        fprintf(stderr, "[FAIL] Overflowing realloc changed %p\n", (void*)d); abort();
+    }
+
+    dam_free(d);
+    printf("  PASS\n\n");
+}
+
+static void test_direct_alignment(void) {
+    printf("=== Test 11: Page aligned direct payloads ===\n");
+    dam_snapshot_t before = {0};
+    dam_snapshot(&before);
+
+    void* a = dam_malloc(MiB(64));
+    if ((uintptr_t)a % PAGE_SIZE != 0) {
+        fprintf(stderr, "[FAIL] Direct payload %p is not page aligned\n", a); abort();
+    }
+
+    dam_snapshot_t after = {0};
+    dam_snapshot(&after);
+    if (after.direct_bytes_used - before.direct_bytes_used != MiB(64)) {
+        fprintf(stderr, "[FAIL] 64 MiB request mapped %zu bytes\n", after.direct_bytes_used - before.direct_bytes_used); abort();
+    }
+
+    memset(a, 0x11, MiB(64));
+    if (!dam_validate_ptr(a, 0, 0)) {
+        fprintf(stderr, "[FAIL] Direct pointer does not validate\n"); abort();
+    }
+    dam_free(a);
+    printf("  PASS\n\n");
+}
+
+#define SPAN_PROBE_COUNT 64
+
+static void test_spans(void) {
+    printf("=== Test 12: Page spans ===\n");
+    if (dam_layer_for_size(KiB(128)) != DAM_LAYER_SPAN || dam_layer_for_size(DAM_SPAN_MAX + 1) != DAM_LAYER_DIRECT) {
+        fprintf(stderr, "[FAIL] Span layer boundaries\n"); abort();
+    }
+
+    dam_snapshot_t before = {0};
+    dam_snapshot(&before);
+
+    void* ptrs[SPAN_PROBE_COUNT];
+    size_t sizes[SPAN_PROBE_COUNT];
+    for (size_t rep = 0; rep < 50; rep++) {
+        for (size_t k = 0; k < SPAN_PROBE_COUNT; k++) {
+            sizes[k] = DAM_GENERAL_MAX + 1 + rand32() % MiB(4);
+            ptrs[k] = dam_malloc(sizes[k]);
+            if (!ptrs[k] || (uintptr_t)ptrs[k] % PAGE_SIZE != 0) {
+                fprintf(stderr, "[FAIL] Bad span %p for size=%zu\n", ptrs[k], sizes[k]); abort();
+            }
+            fill_magic(ptrs[k], sizes[k], (uint32_t)k | 1);
+        }
+
+        for (size_t k = 0; k < SPAN_PROBE_COUNT; k += 2) {
+            size_t new_size = DAM_GENERAL_MAX + 1 + rand32() % MiB(8);
+            void* p = dam_realloc(ptrs[k], new_size);
+            size_t check = new_size < sizes[k] ? new_size : sizes[k];
+            if (!p || !verify_magic(p, check, (uint32_t)k | 1)) {
+                fprintf(stderr, "[FAIL] Span realloc lost data\n"); abort();
+            }
+            fill_magic(p, new_size, (uint32_t)k | 1);
+            ptrs[k] = p;
+            sizes[k] = new_size;
+        }
+
+        for (size_t k = 0; k < SPAN_PROBE_COUNT; k++) {
+            if (!verify_magic(ptrs[k], sizes[k], (uint32_t)k | 1) || !dam_validate_ptr(ptrs[k], 0, 0)) {
+                fprintf(stderr, "[FAIL] Span corruption k=%zu\n", k); abort();
+            }
+            dam_free(ptrs[k]);
+        }
+    }
+
+    dam_snapshot_t after = {0};
+    dam_snapshot(&after);
+    if (after.span_chunks != before.span_chunks || after.span_bytes_used != before.span_bytes_used) {
+        fprintf(stderr, "[FAIL] Spans not released: chunks=%zu used=%zu\n", after.span_chunks, after.span_bytes_used); abort();
+    }
+    printf("  PASS\n\n");
+}
+
+static void test_huge_pages(void) {
+    printf("=== Test 13: Huge page policy ===\n");
+    dam_set_huge_page_policy(DAM_HUGE_PAGE_MADVISE | DAM_HUGE_PAGE_HUGETLB | DAM_HUGE_PAGE_ROUND_POOLS);
+    dam_direct_cache_flush();
+
+    dam_snapshot_t before = {0};
+    dam_snapshot(&before);
+
+    // MAP_HUGETLB usually has no reserved pages, the allocation must still succeed.
+    void* a = dam_malloc(MiB(48));
+    if (!a) {
+        fprintf(stderr, "[FAIL] Huge page direct allocation returned NULL\n"); abort();
+    }
+    memset(a, 0x22, MiB(48));
+    void* b = dam_realloc(a, MiB(80));
+    if (!b || ((uint8_t*)b)[MiB(48) - 1] != 0x22) {
+        fprintf(stderr, "[FAIL] Huge page direct realloc lost data\n"); abort();
+    }
+
+    dam_snapshot_t after = {0};
+    dam_snapshot(&after);
+    printf("  huge_page_bytes: %zu -> %zu\n", before.huge_page_bytes, after.huge_page_bytes);
+
+    dam_free(b);
+    dam_set_huge_page_policy(DAM_HUGE_PAGE_POLICY);
+    printf("  PASS\n\n");
+}
+
+static void test_reserve(void) {
+    printf("=== Test 14: Reservations ===\n");
+    unsigned flags = DAM_RESERVE_POPULATE | DAM_RESERVE_WILLNEED;
+
+    if (dam_reserve(DAM_RESERVE_CLASS(size_to_class(64, 0)), KiB(256), flags) ||
+        dam_reserve(DAM_RESERVE_GENERAL, MiB(4), flags) ||
+        dam_reserve(DAM_RESERVE_SPAN, MiB(8), flags) ||
+        dam_reserve(DAM_RESERVE_DIRECT, MiB(48), flags)) {
+        fprintf(stderr, "[FAIL] dam_reserve failed\n"); abort();
+    }
+    if (dam_reserve(DAM_SIZE_CLASS_COUNT, KiB(1), flags) == 0) {
+        fprintf(stderr, "[FAIL] dam_reserve accepted an invalid class\n"); abort();
+    }
+
+    dam_snapshot_t before = {0};
+    dam_snapshot(&before);
+
+    // Fits the reserved mapping, must come from the cache.
+    void* a = dam_malloc(MiB(40));
+    dam_snapshot_t during = {0};
+    dam_snapshot(&during);
+    if (during.direct_cached_mappings + 1 != before.direct_cached_mappings) {
+        fprintf(stderr, "[FAIL] Reserved direct mapping was not used\n"); abort();
+    }
+    memset(a, 0x33, MiB(40));
+    dam_free(a);
+
+    dam_snapshot_t after = {0};
+    dam_snapshot(&after);
+    if (after.direct_cached_mappings != before.direct_cached_mappings) {
+        fprintf(stderr, "[FAIL] Reserved direct mapping was not kept\n"); abort();
+    }
+
+    dam_direct_cache_flush();
+    printf("  PASS\n\n");
+}
+
+static void test_mallocx(void) {
+    printf("=== Test 15: Extended allocation ===\n");
+    size_t sizes[] = { 24, 200, 3000, KiB(100), MiB(40) };
+    size_t alignments[] = { 64, PAGE_SIZE, MiB(2) };
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        for (size_t j = 0; j < sizeof(alignments) / sizeof(alignments[0]); j++) {
+            unsigned char* p = dam_mallocx(sizes[i], DAM_MALLOCX_ALIGN(alignments[j]) | DAM_MALLOCX_ZERO);
+            if (!p || (uintptr_t)p % alignments[j] != 0) {
+                fprintf(stderr, "[FAIL] mallocx size=%zu align=%zu gave %p\n", sizes[i], alignments[j], (void*)p); abort();
+            }
+            for (size_t k = 0; k < sizes[i]; k += 97) {
+                if (p[k]) { fprintf(stderr, "[FAIL] mallocx memory not zeroed\n"); abort(); }
+            }
+            fill_magic(p, sizes[i], 0xA5A50000u + (uint32_t)i);
+
+            // Grow and keep the alignment, the new tail must be zero.
+            unsigned char* q = dam_reallocx(p, sizes[i] * 2, DAM_MALLOCX_ALIGN(alignments[j]) | DAM_MALLOCX_ZERO);
+            if (!q || (uintptr_t)q % alignments[j] != 0 || !verify_magic(q, sizes[i], 0xA5A50000u + (uint32_t)i)) {
+                fprintf(stderr, "[FAIL] reallocx size=%zu align=%zu\n", sizes[i], alignments[j]); abort();
+            }
+            for (size_t k = sizes[i]; k < sizes[i] * 2; k += 97) {
+                if (q[k]) { fprintf(stderr, "[FAIL] reallocx tail not zeroed\n"); abort(); }
+            }
+            dam_free(q);
+        }
+    }
+
+    void* central = dam_mallocx(48, DAM_MALLOCX_NO_TCACHE | DAM_MALLOCX_POPULATE);
+    void* huge = dam_mallocx(MiB(4), DAM_MALLOCX_HUGE);
+    if (!central || !huge || (uintptr_t)huge % MiB(2) != 0) {
+        fprintf(stderr, "[FAIL] mallocx flags\n"); abort();
+    }
+    memset(huge, 0x5a, MiB(4));
+    dam_free(central);
+    dam_free(huge);
+
+    dam_direct_cache_flush();
+    printf("  PASS\n\n");
+}
+
+static void test_aligned_alloc(void) {
+    printf("=== Test 16: Aligned allocation ===\n");
+    size_t sizes[] = { 1, 40, 100, 1000, KiB(20), KiB(200) };
+    size_t alignments[] = { 16, 32, 64, 128, 1024, PAGE_SIZE, KiB(64) };
+    void* ptrs[sizeof(sizes) / sizeof(sizes[0])][sizeof(alignments) / sizeof(alignments[0])];
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        for (size_t j = 0; j < sizeof(alignments) / sizeof(alignments[0]); j++) {
+            void* p = NULL;
+            if (j % 3 == 0) p = dam_aligned_alloc(alignments[j], sizes[i]);
+            else if (j % 3 == 1) p = dam_memalign(alignments[j], sizes[i]);
+            else if (dam_posix_memalign(&p, alignments[j], sizes[i]) != 0) p = NULL;
+
+            if (!p || (uintptr_t)p % alignments[j] != 0) {
+                fprintf(stderr, "[FAIL] size=%zu align=%zu gave %p\n", sizes[i], alignments[j], p); abort();
+            }
+            fill_magic(p, sizes[i], (uint32_t)(i * 31 + j));
+            ptrs[i][j] = p;
+        }
+    }
+
+    // Neighbours must be untouched, and the pointers must be accepted by dam_realloc()/dam_free() as is.
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        for (size_t j = 0; j < sizeof(alignments) / sizeof(alignments[0]); j++) {
+            if (!verify_magic(ptrs[i][j], sizes[i], (uint32_t)(i * 31 + j))) {
+                fprintf(stderr, "[FAIL] aligned block %p was overwritten\n", ptrs[i][j]); abort();
+            }
+            if (!dam_validate_ptr(ptrs[i][j], 0, 0)) {
+                fprintf(stderr, "[FAIL] aligned block %p does not validate\n", ptrs[i][j]); abort();
+            }
+            void* q = dam_realloc(ptrs[i][j], sizes[i] + 300);
+            if (!q || !verify_magic(q, sizes[i], (uint32_t)(i * 31 + j))) {
+                fprintf(stderr, "[FAIL] realloc of aligned block %p\n", ptrs[i][j]); abort();
+            }
+            dam_free(q);
+        }
+    }
+
+    void* p = NULL;
+    if (dam_posix_memalign(&p, 24, 64) != EINVAL || dam_aligned_alloc(48, 64) != NULL) {
+        fprintf(stderr, "[FAIL] Invalid alignment accepted\n"); abort();
+    }
+
+    // Sizes that wrap once the alignment is added must fail, not land in a small block.
+    size_t huge_alignment = DAM_SPAN_MAX * 2;
+    if (dam_aligned_alloc(64, SIZE_MAX - 10) || dam_aligned_alloc(PAGE_SIZE, SIZE_MAX - PAGE_SIZE)
+        || dam_aligned_alloc(huge_alignment, SIZE_MAX - huge_alignment)) {
+        fprintf(stderr, "[FAIL] Overflowing aligned_alloc succeeded\n"); abort();
+    }
+    p = NULL;
+    if (dam_posix_memalign(&p, 128, SIZE_MAX - 50) != ENOMEM || p) {
+        fprintf(stderr, "[FAIL] Overflowing posix_memalign succeeded\n"); abort();
+    }
+
+    printf("  PASS\n\n");
+}
+
+static void test_usable_size(void) {
+    printf("=== Test 17: Usable size ===\n");
+    size_t sizes[] = { 1, 17, 250, 300, 5000, KiB(70), MiB(3) + 1, MiB(40) + 1 };
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        size_t actual = 0;
+        unsigned char* p = dam_malloc_at_least(sizes[i], &actual);
+        if (!p || actual < sizes[i] || dam_usable_size(p) != actual) {
+            fprintf(stderr, "[FAIL] size=%zu actual=%zu usable=%zu\n", sizes[i], actual, dam_usable_size(p)); abort();
+        }
+
+        // The whole capacity is ours, and survives a realloc.
+        fill_magic(p, actual, 0xC0DE0000u + (uint32_t)i);
+        if (!dam_validate_ptr(p, 0, 0)) {
+            fprintf(stderr, "[FAIL] Using the spare capacity of %p broke its metadata\n", (void*)p); abort();
+        }
+        unsigned char* q = dam_realloc(p, actual + 1);
+        if (!q || !verify_magic(q, actual, 0xC0DE0000u + (uint32_t)i)) {
+            fprintf(stderr, "[FAIL] realloc lost the spare capacity of size=%zu\n", sizes[i]); abort();
+        }
+        dam_free(q);
+    }
+
+    // A plain allocation reports its recorded size and asking does not touch it.
+    unsigned char* plain = dam_malloc(5000);
+    if (dam_usable_size(plain) != 5000 || !dam_validate_ptr(plain, 0, 0)) {
+        fprintf(stderr, "[FAIL] dam_usable_size(%p) changed the block\n", (void*)plain); abort();
+    }
+    dam_free(plain);
+
+    // Heap blocks may be bigger than the general layer.
+    dam_heap_t* heap = dam_heap_create();
+    unsigned char* big = dam_heap_malloc(heap, KiB(100));
+    if (!big || dam_usable_size(big) < KiB(100)) {
+        fprintf(stderr, "[FAIL] heap block usable=%zu\n", big ? dam_usable_size(big) : 0); abort();
+    }
+    dam_heap_destroy(heap);
+
+    if (dam_usable_size(NULL) != 0) {
+        fprintf(stderr, "[FAIL] dam_usable_size(NULL)\n"); abort();
+    }
+
+    dam_direct_cache_flush();
+    printf("  PASS\n\n");
+}
+
+static void test_free_sized(void) {
+    printf("=== Test 18: Sized free ===\n");
+    size_t sizes[] = { 8, 256, 257, 4000, KiB(64), KiB(64) + 1, MiB(32), MiB(32) + 1 };
+
+    dam_snapshot_t before = {0};
+    dam_snapshot(&before);
+
+    for (int round = 0; round < 4; round++) {
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+            void* p = dam_malloc(sizes[i]);
+            if (!p) { fprintf(stderr, "[FAIL] malloc(%zu)\n", sizes[i]); abort(); }
+            fill_magic(p, sizes[i], 0xF5EE0000u + (uint32_t)i);
+            dam_free_sized(p, sizes[i]);
+        }
+    }
+
+    // A general block shrunk below DAM_SMALL_MAX moves to the small layer, so its size still routes.
+    void* g = dam_malloc(1000);
+    void* s = dam_realloc(g, 100);
+    dam_free_sized(s, 100);
+
+    // Grown past DAM_GENERAL_MAX it moves to the span layer, even with enough free space behind it.
+    void** chain = NULL;
+    void** edge = dam_malloc(1000);
+    block_header_t* next = get_block_header(edge)->next_ptr;
+    while (!next || !next->is_free || next->size < KiB(200)) {
+        *edge = chain;
+        chain = edge;
+        edge = dam_malloc(1000);
+        next = get_block_header(edge)->next_ptr;
+    }
+    void* grown = dam_realloc(edge, KiB(200));
+    if (!grown || grown == edge) { fprintf(stderr, "[FAIL] realloc past DAM_GENERAL_MAX stayed in place\n"); abort(); }
+    dam_free_sized(grown, KiB(200));
+    while (chain) {
+        void** prev = *chain;
+        dam_free(chain);
+        chain = prev;
+    }
+
+    // Capacity from dam_malloc_at_least() is a valid size as well.
+    size_t actual = 0;
+    void* a = dam_malloc_at_least(KiB(63) + 900, &actual);
+    dam_free_sized(a, actual);
+
+    dam_snapshot_t after = {0};
+    dam_snapshot(&after);
+    if (after.span_bytes_used != before.span_bytes_used || after.direct_allocations != before.direct_allocations) {
+        fprintf(stderr, "[FAIL] Sized free leaked spans or direct mappings\n"); abort();
+    }
+
+    dam_direct_cache_flush();
+    printf("  PASS\n\n");
+}
+
+static void test_batch(void) {
+    printf("=== Test 19: Batch allocation ===\n");
+    size_t sizes[] = { 24, 256, 700, KiB(100), MiB(40) };
+    size_t counts[] = { 500, 200, 150, 4, 2 };
+    void* ptrs[500];
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        size_t got = dam_malloc_batch(sizes[i], counts[i], ptrs);
+        if (got != counts[i]) {
+            fprintf(stderr, "[FAIL] batch of %zu x %zu gave %zu\n", counts[i], sizes[i], got); abort();
+        }
+        for (size_t j = 0; j < got; j++) fill_magic(ptrs[j], sizes[i], (uint32_t)(j * 7 + i));
+        for (size_t j = 0; j < got; j++) {
+            if (!verify_magic(ptrs[j], sizes[i], (uint32_t)(j * 7 + i))) {
+                fprintf(stderr, "[FAIL] batch block %zu of size %zu overlaps\n", j, sizes[i]); abort();
+            }
+        }
+        dam_free_batch(ptrs, got);
+    }
+
+    // Mixed layers and NULL entries in one free batch.
+    for (size_t j = 0; j < 300; j++) ptrs[j] = (j % 10 == 9) ? NULL : dam_malloc(sizes[j % 4]);
+    dam_free_batch(ptrs, 300);
+
+    // Freed blocks must be reusable.
+    size_t got = dam_malloc_batch(64, 300, ptrs);
+    if (got != 300) { fprintf(stderr, "[FAIL] batch reuse\n"); abort(); }
+    dam_free_batch(ptrs, got);
+
+    dam_direct_cache_flush();
+    printf("  PASS\n\n");
+}
+
+static int is_zeroed(const unsigned char* p, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (p[i]) return 0;
+    }
+    return 1;
+}
+
+static void test_calloc(void) {
+    printf("=== Test 20: Zero-aware calloc ===\n");
+    size_t sizes[] = { 100, 3000, KiB(40), KiB(200), MiB(3), MiB(40) };
+
+    if (dam_calloc(SIZE_MAX / 2, 3) != NULL || dam_calloc(3, SIZE_MAX / 2) != NULL) {
+        fprintf(stderr, "[FAIL] calloc overflow not detected\n"); abort();
+    }
+
+    // Dirty memory of every layer, hand it back, and calloc it again.
+    for (int round = 0; round < 3; round++) {
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+            unsigned char* p = dam_calloc(1, sizes[i]);
+            if (!p || !is_zeroed(p, sizes[i])) {
+                fprintf(stderr, "[FAIL] calloc(%zu) round %d not zeroed\n", sizes[i], round); abort();
+            }
+            memset(p, 0xAB, sizes[i]);
+            dam_free(p);
+
+            unsigned char* q = dam_calloc(sizes[i] / 8, 8);
+            if (!q || !is_zeroed(q, sizes[i] / 8 * 8)) {
+                fprintf(stderr, "[FAIL] calloc(%zu) after reuse not zeroed\n", sizes[i]); abort();
+            }
+            memset(q, 0xCD, sizes[i] / 8 * 8);
+            dam_free(q);
+        }
+    }
+
+    // Coalesced and split general blocks keep their dead headers out of known zero memory.
+    void* blocks[64];
+    for (size_t i = 0; i < 64; i++) {
+        blocks[i] = dam_malloc(300 + i * 37);
+        memset(blocks[i], 0xEE, 300 + i * 37);
+    }
+    for (size_t i = 0; i < 64; i += 2) dam_free(blocks[i]);
+    for (size_t i = 0; i < 64; i += 2) {
+        unsigned char* p = dam_calloc(1, 500 + i * 13);
+        if (!p || !is_zeroed(p, 500 + i * 13)) {
+            fprintf(stderr, "[FAIL] calloc from fragmented general pool not zeroed\n"); abort();
+        }
+        blocks[i] = p;
+    }
+    for (size_t i = 0; i < 64; i++) dam_free(blocks[i]);
+
+    dam_direct_cache_flush();
+    printf("  PASS\n\n");
+}
+
+static void test_memory_kernels(void) {
+    printf("=== Test 21: Copy and zero kernels ===\n");
+    size_t sizes[] = { 0, 1, 15, 63, 64, 65, 255, 1000, 4097, KiB(64) + 3, MiB(9) + 17 };
+    size_t max = MiB(9) + 17 + 128;
+
+    unsigned char* src = dam_malloc(max);
+    unsigned char* dst = dam_malloc(max);
+    if (!src || !dst) { fprintf(stderr, "[FAIL] kernel buffers\n"); abort(); }
+    for (size_t i = 0; i < max; i++) src[i] = (unsigned char)(i * 131 + 7);
+
+    // Every size at every offset, the bytes around the destination range must stay untouched.
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        for (size_t offset = 0; offset < 64; offset += 7) {
+            size_t size = sizes[i];
+            memset(dst, 0x5A, size + 128);
+
+            dam_memcpy(dst + offset, src + (offset ^ 3), size);
+            if (memcmp(dst + offset, src + (offset ^ 3), size) != 0 || dst[offset + size] != 0x5A
+                || (offset && dst[offset - 1] != 0x5A)) {
+                fprintf(stderr, "[FAIL] dam_memcpy size %zu offset %zu\n", size, offset); abort();
+            }
+
+            dam_memzero(dst + offset, size);
+            if (!is_zeroed(dst + offset, size) || dst[offset + size] != 0x5A
+                || (offset && dst[offset - 1] != 0x5A)) {
+                fprintf(stderr, "[FAIL] dam_memzero size %zu offset %zu\n", size, offset); abort();
+            }
+        }
+    }
+
+    dam_free(src);
+    dam_free(dst);
+    dam_direct_cache_flush();
+    printf("  PASS\n\n");
+}
+
+static void* deferred_free_worker(void* arg) {
+    size_t* freed = arg;
+
+    if (dam_deferred_free_enable() != 0) return NULL;
+
+    // More frees than the ring holds, the overflow is freed synchronously.
+    for (size_t i = 0; i < 3 * DAM_DEFERRED_FREE_RING_SIZE; i++) {
+        void* p = dam_malloc(i % 2 ? KiB(100) : 3000);
+        if (!p) return NULL;
+        fill_magic(p, 3000, (uint32_t)i);
+        dam_free(p);
+        (*freed)++;
+    }
+
+    return NULL; // Exits with deferral still on, the reclaimer owns the ring now
+}
+
+// Keeps the reclaimer unregistering spans and direct mappings while other threads look up pools.
+static void* deferred_unmap_worker(void* arg) {
+    uint8_t* done = arg;
+
+    if (dam_deferred_free_enable() == 0) {
+        for (size_t i = 0; i < 2000; i++) {
+            dam_free(dam_malloc(i % 2 ? DAM_SPAN_MAX + 1 : KiB(200)));
+            if (i % 64 == 0) dam_direct_cache_flush();
+        }
+        dam_deferred_free_disable();
+    }
+
+    __atomic_store_n(done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+static void test_deferred_free(void) {
+    printf("=== Test 22: Deferred free ===\n");
+    dam_snapshot_t before = {0}, after = {0};
+    dam_snapshot(&before);
+
+    if (dam_deferred_free_enable() != 0) { fprintf(stderr, "[FAIL] deferred free enable\n"); abort(); }
+
+    void* blocks[64];
+    size_t sizes[] = { 100, 5000, KiB(200), MiB(40) };
+    for (size_t i = 0; i < 64; i++) {
+        blocks[i] = dam_malloc(sizes[i % 4]);
+        if (!blocks[i]) { fprintf(stderr, "[FAIL] deferred free malloc\n"); abort(); }
+        fill_magic(blocks[i], 100, (uint32_t)i);
+    }
+    for (size_t i = 0; i < 64; i++) {
+        if (i % 2) dam_free(blocks[i]);
+        else dam_free_sized(blocks[i], sizes[i % 4]);
+    }
+
+    pthread_t worker;
+    size_t freed = 0;
+    pthread_create(&worker, NULL, deferred_free_worker, &freed);
+    pthread_join(worker, NULL);
+    if (freed != 3 * DAM_DEFERRED_FREE_RING_SIZE) { fprintf(stderr, "[FAIL] deferred free worker\n"); abort(); }
+
+    uint8_t done = 0;
+    void* probe = dam_malloc(5000);
+    pthread_create(&worker, NULL, deferred_unmap_worker, &done);
+    while (!__atomic_load_n(&done, __ATOMIC_ACQUIRE)) {
+        if (dam_usable_size(probe) != 5000) { fprintf(stderr, "[FAIL] pool lookup during reclaim\n"); abort(); }
+        dam_free(dam_malloc(100));
+    }
+    pthread_join(worker, NULL);
+    dam_free(probe);
+
+    dam_deferred_free_disable();
+    dam_deferred_free_flush();
+    dam_snapshot(&after);
+
+    if (after.span_bytes_used != before.span_bytes_used || after.direct_allocations != before.direct_allocations) {
+        fprintf(stderr, "[FAIL] deferred frees not reclaimed: span %zu -> %zu, direct %zu -> %zu\n",
+            before.span_bytes_used, after.span_bytes_used, before.direct_allocations, after.direct_allocations);
+        abort();
+    }
+
+    dam_direct_cache_flush();
+    printf("  PASS\n\n");
+}
+
+static void test_arena(void) {
+    printf("=== Test 23: Arena ===\n");
+    dam_snapshot_t before = {0}, after = {0};
+    dam_snapshot(&before);
+
+    dam_arena_t* arena = dam_arena_create(KiB(8));
+    if (!arena) { fprintf(stderr, "[FAIL] arena create\n"); abort(); }
+
+    void* first[2] = { NULL, NULL };
+    for (int round = 0; round < 2; round++) {
+        void* ptrs[512];
+        size_t sizes[512];
+
+        for (size_t i = 0; i < 512; i++) {
+            sizes[i] = i % 97 == 0 ? KiB(200) : 1 + rand32() % 700;
+            size_t alignment = i % 13 == 0 ? 4096 : 0;
+
+            ptrs[i] = alignment ? dam_arena_alloc_aligned(arena, sizes[i], alignment) : dam_arena_alloc(arena, sizes[i]);
+            if (!ptrs[i] || (uintptr_t)ptrs[i] % (alignment ? alignment : ALIGNMENT) != 0) {
+                fprintf(stderr, "[FAIL] arena alloc %zu\n", i); abort();
+            }
+            fill_magic(ptrs[i], sizes[i], (uint32_t)(i * 7 + round));
+        }
+        for (size_t i = 0; i < 512; i++) {
+            if (!verify_magic(ptrs[i], sizes[i], (uint32_t)(i * 7 + round))) {
+                fprintf(stderr, "[FAIL] arena allocation %zu overlapped\n", i); abort();
+            }
+        }
+
+        first[round] = ptrs[0];
+        dam_arena_reset(arena);
+    }
+
+    // Reset rewinds into the chunks already held.
+    if (first[0] != first[1]) { fprintf(stderr, "[FAIL] arena reset did not reuse its first chunk\n"); abort(); }
+    if (dam_arena_alloc_aligned(arena, 64, 48) != NULL) { fprintf(stderr, "[FAIL] arena accepted bad alignment\n"); abort(); }
+
+    dam_arena_destroy(arena);
+    dam_direct_cache_flush();
+    dam_snapshot(&after);
+
+    if (after.span_bytes_used != before.span_bytes_used || after.direct_allocations != before.direct_allocations) {
+        fprintf(stderr, "[FAIL] arena destroy leaked chunks\n"); abort();
+    }
+
+    printf("  PASS\n\n");
+}
+
+static size_t heap_pool_count(void) {
+    size_t count = 0;
+    for (pool_header_t* pool = dam_pool_list; pool; pool = pool->next) {
+        if (pool->heap) count++;
+    }
+    return count;
+}
+
+static void test_heaps(void) {
+    printf("=== Test 24: Isolated heaps ===\n");
+
+    dam_heap_t* heaps[2] = { dam_heap_create(), dam_heap_create() };
+    if (!heaps[0] || !heaps[1]) { fprintf(stderr, "[FAIL] heap create\n"); abort(); }
+
+    void* ptrs[2][300];
+    size_t sizes[300];
+    for (size_t i = 0; i < 300; i++) {
+        sizes[i] = i % 50 == 0 ? KiB(150) : 1 + rand32() % 3000;
+        for (int h = 0; h < 2; h++) {
+            ptrs[h][i] = dam_heap_malloc(heaps[h], sizes[i]);
+            pool_header_t* pool = ptrs[h][i] ? dam_pool_from_ptr(ptrs[h][i]) : NULL;
+            if (!pool || pool->heap != heaps[h]) { fprintf(stderr, "[FAIL] heap %d alloc %zu\n", h, i); abort(); }
+            fill_magic(ptrs[h][i], sizes[i], (uint32_t)(i * 2 + h));
+        }
+    }
+
+    // Frees and reallocs, through the heap API and the global one, stay inside the heap.
+    for (size_t i = 0; i < 300; i += 3) {
+        dam_heap_free(heaps[0], ptrs[0][i]);
+        dam_free(ptrs[1][i]);
+        ptrs[0][i] = ptrs[1][i] = NULL;
+    }
+    for (size_t i = 1; i < 300; i += 3) {
+        for (int h = 0; h < 2; h++) {
+            void* grown = h ? dam_realloc(ptrs[h][i], sizes[i] * 2 + 100) : dam_heap_realloc(heaps[h], ptrs[h][i], sizes[i] * 2 + 100);
+            if (!grown || dam_pool_from_ptr(grown)->heap != heaps[h] || !verify_magic(grown, sizes[i], (uint32_t)(i * 2 + h))) {
+                fprintf(stderr, "[FAIL] heap %d realloc %zu\n", h, i); abort();
+            }
+            ptrs[h][i] = grown;
+        }
+    }
+
+    void* global[64];
+    for (size_t i = 0; i < 64; i++) {
+        global[i] = dam_malloc(16 + i * 40);
+        if (!global[i] || dam_pool_from_ptr(global[i])->heap) { fprintf(stderr, "[FAIL] global alloc in heap pool\n"); abort(); }
+    }
+
+    // Destroying one heap with live allocations leaves the other untouched.
+    dam_heap_destroy(heaps[0]);
+    for (size_t i = 0; i < 300; i++) {
+        if (ptrs[1][i] && !verify_magic(ptrs[1][i], sizes[i], (uint32_t)(i * 2 + 1))) {
+            fprintf(stderr, "[FAIL] heap 1 allocation %zu damaged\n", i); abort();
+        }
+    }
+    dam_heap_destroy(heaps[1]);
+
+    for (size_t i = 0; i < 64; i++) dam_free(global[i]);
+
+    if (heap_pool_count() != 0) { fprintf(stderr, "[FAIL] %zu heap pools left behind\n", heap_pool_count()); abort(); }
+
+    printf("  PASS\n\n");
+}
+
+static void test_shared_heap(void) {
+    printf("=== Test 25: Shared memory heap ===\n");
+
+    // A child maps the memfd on its own and hands a message back as an offset.
+    dam_shared_heap_t* heap = dam_shared_create(NULL, MiB(4));
+    if (!heap) { fprintf(stderr, "[FAIL] shared create\n"); abort(); }
+
+    int pipe_fds[2];
+    if (pipe(pipe_fds) != 0) { fprintf(stderr, "[FAIL] pipe\n"); abort(); }
+
+    pid_t child = fork();
+    if (child == 0) {
+        dam_shared_heap_t* mapped = dam_shared_open_fd(dam_shared_fd(heap));
+        uint64_t offset = 0;
+        if (mapped) {
+            void* message = dam_shared_malloc(mapped, KiB(100));
+            if (message) {
+                fill_magic(message, KiB(100), 0xC0FFEE);
+                offset = dam_shared_offset(mapped, message);
+            }
+        }
+        ssize_t written = write(pipe_fds[1], &offset, sizeof(offset));
+        _exit(written == sizeof(offset) ? 0 : 1);
+    }
+
+    uint64_t offset = 0;
+    if (read(pipe_fds[0], &offset, sizeof(offset)) != sizeof(offset) || !offset) {
+        fprintf(stderr, "[FAIL] child did not send a message\n"); abort();
+    }
+    waitpid(child, NULL, 0);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+
+    void* message = dam_shared_ptr(heap, offset);
+    if (!message || !verify_magic(message, KiB(100), 0xC0FFEE)) {
+        fprintf(stderr, "[FAIL] shared message corrupted\n"); abort();
+    }
+    dam_shared_free(heap, message);
+
+    // Split and coalesce give the whole region back.
+    void* blocks[200];
+    for (size_t i = 0; i < 200; i++) {
+        blocks[i] = dam_shared_malloc(heap, 1 + rand32() % 8000);
+        if (!blocks[i]) { fprintf(stderr, "[FAIL] shared malloc %zu\n", i); abort(); }
+    }
+    for (size_t i = 0; i < 200; i += 2) dam_shared_free(heap, blocks[i]);
+    for (size_t i = 1; i < 200; i += 2) dam_shared_free(heap, blocks[i]);
+    if (!dam_shared_malloc(heap, MiB(4) - KiB(4))) { fprintf(stderr, "[FAIL] shared region did not coalesce\n"); abort(); }
+    dam_shared_close(heap);
+
+    // Two mappings of one named object see the same allocations at different addresses.
+    char name[64];
+    snprintf(name, sizeof(name), "/dam_test_%d", (int)getpid());
+    dam_shared_heap_t* writer = dam_shared_create(name, MiB(1));
+    dam_shared_heap_t* reader = dam_shared_open(name);
+    if (!writer || !reader || dam_shared_create(name, MiB(1)) != NULL) { fprintf(stderr, "[FAIL] named shared heap\n"); abort(); }
+
+    void* data = dam_shared_malloc(writer, 3000);
+    fill_magic(data, 3000, 0xBEEF);
+    void* seen = dam_shared_ptr(reader, dam_shared_offset(writer, data));
+    if (seen == data || !verify_magic(seen, 3000, 0xBEEF)) { fprintf(stderr, "[FAIL] named shared heap mapping\n"); abort(); }
+    dam_shared_free(reader, seen);
+
+    dam_shared_close(writer);
+    dam_shared_close(reader);
+    dam_shared_unlink(name);
+
+    // A process dying with the lock held hands over intact metadata, torn metadata makes the region unusable.
+    for (int torn = 0; torn < 2; torn++) {
+        dam_shared_heap_t* orphan = dam_shared_create(NULL, MiB(1));
+        if (!orphan) { fprintf(stderr, "[FAIL] shared create\n"); abort(); }
+
+        pid_t holder = fork();
+        if (holder == 0) {
+            dam_region_lock(orphan->region);
+            if (torn) orphan->region->bytes_used += ALIGNMENT;
+            _exit(0);
+        }
+        waitpid(holder, NULL, 0);
+
+        for (int attempt = 0; attempt < 2; attempt++) {
+            void* block = dam_shared_malloc(orphan, 100);
+            if (torn ? block != NULL : block == NULL) {
+                fprintf(stderr, "[FAIL] shared heap after lock owner died, torn=%d attempt=%d\n", torn, attempt); abort();
+            }
+            dam_shared_free(orphan, block);
+        }
+        dam_shared_close(orphan);
+    }
+
+    printf("  PASS\n\n");
+}
+
+typedef struct persistent_node {
+    uint64_t next; // offset, pointers do not survive a restart
+    uint32_t value;
+} persistent_node_t;
+
+static void test_persistent_heap(void) {
+    printf("=== Test 26: Persistent heap ===\n");
+
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/dam_test_%d.heap", (int)getpid());
+    unlink(path);
+
+    // First run builds a list and leaves it behind the root.
+    dam_persistent_heap_t* heap = dam_persistent_open(path, MiB(4));
+    if (!heap || dam_persistent_root(heap) != NULL) { fprintf(stderr, "[FAIL] persistent create\n"); abort(); }
+    if (dam_persistent_open(path, MiB(4)) != NULL) { fprintf(stderr, "[FAIL] persistent heap opened twice\n"); abort(); }
+
+    uint64_t head = 0;
+    for (uint32_t i = 0; i < 100; i++) {
+        persistent_node_t* node = dam_persistent_malloc(heap, sizeof(persistent_node_t) + i * 10);
+        if (!node) { fprintf(stderr, "[FAIL] persistent malloc %u\n", i); abort(); }
+        node->next = head;
+        node->value = i;
+        head = dam_persistent_offset(heap, node);
+    }
+    dam_persistent_set_root(heap, dam_persistent_ptr(heap, head));
+    dam_persistent_close(heap);
+
+    // A restart finds the list again, wherever the file gets mapped.
+    heap = dam_persistent_open(path, 0);
+    if (!heap) { fprintf(stderr, "[FAIL] persistent reopen\n"); abort(); }
+
+    uint32_t expected = 100;
+    persistent_node_t* node = dam_persistent_root(heap);
+    while (node) {
+        if (node->value != --expected) { fprintf(stderr, "[FAIL] persistent list value %u\n", node->value); abort(); }
+        persistent_node_t* next = dam_persistent_ptr(heap, node->next);
+        dam_persistent_free(heap, node);
+        node = next;
+    }
+    if (expected != 0) { fprintf(stderr, "[FAIL] persistent list lost %u nodes\n", expected); abort(); }
+    dam_persistent_set_root(heap, NULL);
+    dam_persistent_close(heap);
+
+    // A process dying with intact metadata leaves a heap that still opens.
+    pid_t child = fork();
+    if (child == 0) {
+        dam_persistent_heap_t* mapped = dam_persistent_open(path, 0);
+        if (!mapped) _exit(1);
+        dam_persistent_set_root(mapped, dam_persistent_malloc(mapped, 500));
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+
+    heap = dam_persistent_open(path, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || !heap || !dam_persistent_root(heap)) {
+        fprintf(stderr, "[FAIL] persistent heap after crash\n"); abort();
+    }
+    dam_persistent_close(heap);
+
+    // One dying with torn metadata is refused.
+    child = fork();
+    if (child == 0) {
+        dam_persistent_heap_t* mapped = dam_persistent_open(path, 0);
+        if (!mapped) _exit(1);
+        mapped->region->bytes_used += 4096;
+        _exit(0);
+    }
+    waitpid(child, NULL, 0);
+
+    if (dam_persistent_open(path, 0) != NULL) { fprintf(stderr, "[FAIL] torn persistent heap opened\n"); abort(); }
+    unlink(path);
+
+    printf("  PASS\n\n");
+}
+
+static void test_clone(void) {
+    printf("=== Test 27: Copy-on-write clone ===\n");
+
+    size_t size = MiB(40);
+    char* original = dam_mallocx(size, DAM_MALLOCX_CLONEABLE);
+    if (!original || dam_layer_for_size(size) != DAM_LAYER_DIRECT) { fprintf(stderr, "[FAIL] cloneable malloc\n"); abort(); }
+    fill_magic(original, size, 0x5A5A1234);
+
+    // The snapshot keeps the bytes of the moment it was taken, while both sides keep writing.
+    char* snapshot = dam_clone(original);
+    if (!snapshot || snapshot == original || !verify_magic(snapshot, size, 0x5A5A1234)) {
+        fprintf(stderr, "[FAIL] clone contents\n"); abort();
+    }
+
+    fill_magic(original, MiB(1), 0x0BADF00D);
+    fill_magic(snapshot + size - MiB(1), MiB(1), 0xFEEDFACE);
+    if (!verify_magic(snapshot, MiB(1), 0x5A5A1234) || !verify_magic(original + size - MiB(1), MiB(1), 0x5A5A1234)) {
+        fprintf(stderr, "[FAIL] clone is not copy-on-write\n"); abort();
+    }
+
+    // A second clone has to copy, the original now holds pages its memfd does not.
+    char* copy = dam_clone(original);
+    if (!copy || memcmp(copy, original, size) != 0) { fprintf(stderr, "[FAIL] second clone\n"); abort(); }
+
+    // Snapshots still grow, by copying instead of remapping.
+    original = dam_realloc(original, MiB(48));
+    if (!original || !verify_magic(original, MiB(1), 0x0BADF00D) || !verify_magic(original + MiB(1), size - MiB(1), 0x5A5A1234)) {
+        fprintf(stderr, "[FAIL] snapshot realloc\n"); abort();
+    }
+    memset(original + MiB(48) - 4096, 0x11, 4096);
+
+    dam_free(original);
+    if (!verify_magic(snapshot, MiB(1), 0x5A5A1234)) { fprintf(stderr, "[FAIL] clone outlives the original\n"); abort(); }
+    dam_free(snapshot);
+    dam_free(copy);
+
+    // A memfd that was never cloned grows the file along with the mapping.
+    char* live = dam_mallocx(MiB(33), DAM_MALLOCX_CLONEABLE);
+    fill_magic(live, MiB(33), 0x77);
+    live = dam_realloc(live, MiB(64));
+    if (!live || !verify_magic(live, MiB(33), 0x77)) { fprintf(stderr, "[FAIL] cloneable realloc\n"); abort(); }
+    memset(live + MiB(64) - 4096, 0x22, 4096);
+    char* clone = dam_clone(live);
+    if (!clone || clone[MiB(64) - 1] != 0x22) { fprintf(stderr, "[FAIL] clone after realloc\n"); abort(); }
+    dam_free(live);
+    dam_free(clone);
+
+    // Anything else is copied.
+    char* small = dam_malloc(100);
+    fill_magic(small, 100, 0xABCD);
+    char* small_clone = dam_clone(small);
+    if (!small_clone || small_clone == small || !verify_magic(small_clone, 100, 0xABCD)) { fprintf(stderr, "[FAIL] small clone\n"); abort(); }
+    dam_free(small);
+    dam_free(small_clone);
+
+    printf("  PASS\n\n");
+}
+
+static void test_preload(void) {
+    printf("=== Test 28: LD_PRELOAD interposition ===\n");
+
+#if defined(DAM_PRELOAD_PATH) && !defined(__SANITIZE_ADDRESS__)
+    // Unmodified tools run on DAM from their first allocation, libc and the dynamic loader included.
+    pid_t child = fork();
+    if (child == 0) {
+        setenv("LD_PRELOAD", DAM_PRELOAD_PATH, 1);
+        execl("/bin/sh", "sh", "-c", "ls -R /usr/include > /dev/null && seq 1 100000 | sort -rn | head -n 1 | grep -qx 100000", (char*)NULL);
+        _exit(127);
+    }
+
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) { fprintf(stderr, "[FAIL] preloaded shell exited with %d\n", status); abort(); }
+#else
+    printf("  skipped, no preload library in this build\n");
+#endif
+
+    printf("  PASS\n\n");
+}
+
+static void test_size_class(void) {
+    printf("=== Test 29: Size class allocation ===\n");
+
+    // Every class round-trips, and its blocks are interchangeable with dam_malloc() of the same class.
+    for (unsigned class_index = 0; class_index < DAM_SIZE_CLASS_COUNT; class_index++) {
+        size_t size = (size_t)DAM_SMALL_MIN << class_index;
+        void* blocks[64];
+
+        for (int i = 0; i < 64; i++) {
+            blocks[i] = dam_class_malloc(class_index);
+            if (!blocks[i] || dam_usable_size(blocks[i]) != size) { fprintf(stderr, "[FAIL] class %u block %d\n", class_index, i); abort(); }
+            memset(blocks[i], i, size);
+        }
+        for (int i = 0; i < 64; i++) {
+            if (((unsigned char*)blocks[i])[size - 1] != i) { fprintf(stderr, "[FAIL] class %u block %d overwritten\n", class_index, i); abort(); }
+            if (i % 2) dam_class_free(blocks[i], class_index);
+            else dam_free_sized(blocks[i], size);
+        }
+
+        void* ptr = dam_malloc(size);
+        dam_class_free(ptr, class_index);
+    }
+
+    if (dam_class_malloc(DAM_SIZE_CLASS_COUNT) != NULL) { fprintf(stderr, "[FAIL] class out of range allocated\n"); abort(); }
+
+    printf("  PASS\n\n");
+}
+
 static void test_fragmentation(void) {
     size_t pool_count = dam_pool_count();
     dam_pool_fragmentation_t buffer[pool_count];
@@ -515,6 +1533,27 @@ int main(void) {
     test_sequential_sweep();
     test_realloc_churn();
     test_big_direct_allocations();
+    test_direct_cache();
+    test_direct_remap();
+    test_direct_alignment();
+    test_spans();
+    test_huge_pages();
+    test_reserve();
+    test_mallocx();
+    test_aligned_alloc();
+    test_usable_size();
+    test_free_sized();
+    test_batch();
+    test_calloc();
+    test_memory_kernels();
+    test_deferred_free();
+    test_arena();
+    test_heaps();
+    test_shared_heap();
+    test_persistent_heap();
+    test_clone();
+    test_preload();
+    test_size_class();
     test_fragmentation();
     test_quarantine();
     test_tracing();
@@ -1,5 +1,40 @@
 #include "dam/dam_ptr.hpp"
+#include "dam/dam_arena.hpp"
+#include "dam/dam_allocator.hpp"
+#include "dam/dam_pmr.hpp"
+#include "dam/dam_object_pool.hpp"
+#include "dam/dam_vector.hpp"
+#include <atomic>
 #include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct node {
+    static std::atomic<int> alive;
+    node* next;
+    long value;
+    explicit node(long v) : next(nullptr), value(v) { alive++; }
+    node(node&& other) noexcept : next(other.next), value(other.value) { alive++; }
+    ~node() { alive--; }
+};
+std::atomic<int> node::alive{0};
+
+// Throws from its constructor once budget runs out.
+struct picky {
+    static int budget;
+    static int alive;
+    picky() {
+        if (budget-- == 0) throw std::runtime_error("picky");
+        alive++;
+    }
+    picky(const picky&) : picky() {}
+    ~picky() { alive--; }
+};
+int picky::budget = 0;
+int picky::alive = 0;
 
 int main() {
     // single object
@@ -19,10 +54,150 @@ int main() {
     arr[7] = 99;
     printf("after resize: %d\n", arr[7]);
 
+    // grown past the general layer by dam_realloc(), the sized free still finds it
+    {
+        auto bytes = dam::make_unique<char[]>(1000);
+        bytes.resize(100000);
+        bytes[99999] = 'x';
+        printf("resize across layers: %c\n", bytes[99999]);
+    }
+
     // move
     auto arr2 = std::move(arr);
     printf("moved: %d\n", arr2[0]);
     printf("original null: %d\n", !arr);
 
+    // arena
+    struct point { double x, y; };
+    dam::arena arena(4096);
+    for (int request = 0; request < 3; request++) {
+        dam::arena_scope scope(arena);
+        point* first = nullptr;
+        for (int i = 0; i < 1000; i++) {
+            point* pt = arena.make<point>(point{ double(i), double(request) });
+            if (!first) first = pt;
+        }
+        printf("arena request %d: %.0f %.0f\n", request, first->x, first->y);
+    }
+
+    // standard containers
+    using dam_string = std::basic_string<char, std::char_traits<char>, dam::allocator<char>>;
+    std::vector<int, dam::allocator<int>> numbers;
+    for (int i = 0; i < 100000; i++) numbers.push_back(i);
+    std::unordered_map<int, dam_string, std::hash<int>, std::equal_to<int>,
+                       dam::allocator<std::pair<const int, dam_string>>> names;
+    for (int i = 0; i < 1000; i++) names[i] = dam_string(64, char('a' + i % 26));
+    printf("containers: %d %s %d\n", numbers.back(), names[27].substr(0, 3).c_str(), dam_usable_size(numbers.data()) > 0);
+
+    // std::pmr resources
+    std::pmr::vector<std::pmr::string> global_strings(dam::pmr::global_resource());
+    for (int i = 0; i < 1000; i++) global_strings.emplace_back(100, 'g');
+
+    dam::pmr::synchronized_pool_resource pool;
+    {
+        std::pmr::unordered_map<int, std::pmr::string> pooled(&pool);
+        for (int i = 0; i < 10000; i++) pooled[i] = std::pmr::string(i % 200, 'p');
+        pooled.clear();
+        for (int i = 0; i < 10000; i++) pooled[i] = std::pmr::string(i % 200, 'q');
+    }
+    dam::pmr::unsynchronized_pool_resource local_pool;
+    std::pmr::vector<int> pooled_numbers(&local_pool);
+    for (int i = 0; i < 100000; i++) pooled_numbers.push_back(i);
+
+    dam::pmr::monotonic_resource monotonic(4096);
+    std::pmr::vector<std::pmr::string> words(&monotonic);
+    for (int i = 0; i < 1000; i++) words.emplace_back(50, 'm');
+    printf("pmr: %zu %d %zu\n", global_strings.size(), pooled_numbers.back(), words.size());
+
+    // object pool
+    dam::object_pool<node> nodes;
+    node* head = nullptr;
+    for (long i = 0; i < 100000; i++) {
+        node* n = nodes.construct(i);
+        n->next = head;
+        head = n;
+    }
+    long sum = 0;
+    while (head) {
+        node* next = head->next;
+        sum += head->value;
+        nodes.destroy(head);
+        head = next;
+    }
+    node* reused = nodes.construct(1L);
+    nodes.destroy(reused);
+
+    dam::object_pool<node, std::mutex> shared_nodes;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; t++) {
+        workers.emplace_back([&shared_nodes] {
+            dam::object_pool<node, std::mutex>::magazine magazine(shared_nodes);
+            node* kept[100];
+            for (int round = 0; round < 1000; round++) {
+                for (long i = 0; i < 100; i++) kept[i] = magazine.construct(i);
+                for (long i = 0; i < 100; i++) magazine.destroy(kept[i]);
+            }
+        });
+    }
+    for (std::thread& worker : workers) worker.join();
+    printf("object pool: %ld %d %d\n", sum, node::alive.load(), dam::object_pool<node>::objects_per_slab() > 1);
+
+    // size class dispatch, destructors run on reset, resize and scope exit
+    {
+        auto first = dam::make_unique<node>(1);
+        auto names = dam::make_unique<std::string[]>(2);
+        names[1] = "size class";
+        names.resize(5);
+        first.reset(dam::make_unique<node>(2).release());
+        printf("size class: %u %u %d %s %zu\n", dam::size_class_of(sizeof(node)), dam::size_class_of(DAM_SMALL_MAX),
+            node::alive.load(), names[1].c_str(), names[4].size());
+    }
+    printf("destroyed: %d\n", node::alive.load());
+
+    // dam::vector, realloc growth for trivially relocatable elements, move growth otherwise
+    {
+        dam::vector<long> values;
+        size_t moves = 0;
+        for (long i = 0; i < 4000000; i++) {
+            const long* before = values.data();
+            values.push_back(i);
+            if (before && values.data() != before) moves++;
+        }
+        values.push_back(values[0]);
+        values.resize(10);
+        values.shrink_to_fit();
+
+        dam::vector<std::string> words = { "dam", "vector" };
+        for (int i = 0; i < 1000; i++) words.push_back(words[i % 2]);
+        dam::vector<std::string> copied = words;
+
+        dam::vector<node> nodes_kept;
+        for (long i = 0; i < 1000; i++) nodes_kept.emplace_back(i);
+        printf("vector: %ld %zu %d %s %zu %d %d\n", values[9], values.size(), values.capacity() >= values.size(),
+            copied[1001].c_str(), copied.size(), node::alive.load(), moves < 20);
+    }
+    printf("vector destroyed: %d\n", node::alive.load());
+
+    // dam::vector sized constructors free their block when an element throws
+    int thrown = 0;
+    for (int i = 0; i < 2; i++) {
+        picky::budget = 50;
+        try {
+            if (i == 0) dam::vector<picky> items(100);
+            else dam::vector<picky> items(100, picky());
+        } catch (const std::runtime_error&) {
+            thrown++;
+        }
+    }
+    printf("vector throw: %d %d\n", thrown, picky::alive);
+
+    // global new / delete (dam_new_delete)
+    struct alignas(64) line { char bytes[64]; };
+    int* single = new int(7);
+    line* lines = new line[10];
+    printf("new/delete: %d %d %d\n", *single, dam_usable_size(single) > 0, reinterpret_cast<uintptr_t>(lines) % 64 == 0);
+    delete single;
+    delete[] lines;
+
     return 0;
 }
\ No newline at end of file